@@ -0,0 +1,214 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+//
+// Move generation throughput over a set of "live games", i.e. many unrelated positions visited in
+// turn, which is the access pattern that hurts the attack tables the most.
+//
+// Prints the time per position and, on Linux when perf events are available, the number of dTLB
+// load misses for each run. Compare a default run against CHESSGEN_HUGEPAGES=0 to see the effect
+// of backing the attack tables with huge pages.
+//
+
+#include <chessgen/attacks.hpp>
+#include <chessgen/board.hpp>
+#include <chessgen/movegen.hpp>
+#include <chessgen/position_batch.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace chessgen;
+
+namespace
+{
+// -------------------------------------------------------------------------------------------------
+class TlbMissCounter
+{
+public:
+  TlbMissCounter()
+  {
+#if defined(__linux__)
+    perf_event_attr attr{};
+    attr.type           = PERF_TYPE_HW_CACHE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    mFd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+  ~TlbMissCounter()
+  {
+#if defined(__linux__)
+    if (mFd >= 0) {
+      close(mFd);
+    }
+#endif
+  }
+  TlbMissCounter(TlbMissCounter const&) = delete;
+  TlbMissCounter& operator=(TlbMissCounter const&) = delete;
+
+  bool isAvailable() const
+  {
+    return mFd >= 0;
+  }
+  void start()
+  {
+#if defined(__linux__)
+    if (mFd >= 0) {
+      ioctl(mFd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(mFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+  std::uint64_t stop()
+  {
+    auto count = std::uint64_t{0};
+#if defined(__linux__)
+    if (mFd >= 0) {
+      ioctl(mFd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(mFd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+#endif
+    return count;
+  }
+
+private:
+  int mFd{-1};
+};
+// -------------------------------------------------------------------------------------------------
+std::vector<BoardState> makeLiveGames(std::size_t count)
+{
+  char const* fens[] = {
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  };
+
+  auto states = std::vector<BoardState>{};
+  auto seed   = std::uint64_t{0x2545f4914f6cdd1dULL};
+  while (states.size() < count) {
+    auto board = Board(fens[states.size() % 4]);
+    for (auto ply = 0; ply < 60 && !board.isOver() && states.size() < count; ++ply) {
+      states.push_back(board.getState());
+
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      auto const& moves = board.getLegalMoves();
+      board.makeMove(moves[seed % moves.size()]);
+    }
+  }
+  return states;
+}
+// -------------------------------------------------------------------------------------------------
+template <typename Fn>
+void run(char const* name, std::size_t positions, int rounds, TlbMissCounter& counter, Fn fn)
+{
+  auto checksum = std::uint64_t{0};
+
+  counter.start();
+  auto const begin = std::chrono::steady_clock::now();
+  for (auto round = 0; round < rounds; ++round) {
+    checksum += fn();
+  }
+  auto const end    = std::chrono::steady_clock::now();
+  auto const misses = counter.stop();
+
+  auto const total = static_cast<double>(positions) * rounds;
+  auto const ns    = std::chrono::duration<double, std::nano>(end - begin).count();
+
+  std::printf("%-22s %10.1f ns/position", name, ns / total);
+  if (counter.isAvailable()) {
+    std::printf("  %12llu dTLB misses  %8.3f per position", static_cast<unsigned long long>(misses),
+                static_cast<double>(misses) / total);
+  }
+  std::printf("  (checksum %llu)\n", static_cast<unsigned long long>(checksum));
+}
+}  // namespace
+
+// -------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  auto const count  = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1])) : std::size_t{8192};
+  auto const rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  auto const states = makeLiveGames(count);
+
+  auto batch = PositionBatch(states.size());
+  for (auto const& state : states) {
+    batch.push_back(state);
+  }
+  auto attacks = std::vector<Bitboard>(states.size());
+
+  std::printf("attack tables on %s pages, %zu positions, %d rounds\n",
+              attacks::usesHugePages() ? "huge" : "regular", states.size(), rounds);
+
+  auto counter = TlbMissCounter{};
+  if (!counter.isAvailable()) {
+    std::printf("perf events unavailable, dTLB misses will not be reported\n");
+  }
+
+  run("legal moves", states.size(), rounds, counter, [&] {
+    auto moves = std::uint64_t{0};
+    for (auto const& state : states) {
+      moves += generateMoves<GenType::Legal>(state).size();
+    }
+    return moves;
+  });
+  run("sliding attacks", states.size(), rounds, counter, [&] {
+    auto bits = std::uint64_t{0};
+    for (auto const& state : states) {
+      auto const occupied = state.getOccupied();
+      for (auto color : {ColorWhite, ColorBlack}) {
+        for (auto piece : {PieceBishop, PieceRook, PieceQueen}) {
+          for (auto pieces = state.getPieces(color, piece); pieces;) {
+            auto const from = makeSquare(pieces.popLsb());
+            bits += attacks::getSlidingAttacks(piece, from, occupied).popCount();
+          }
+        }
+      }
+    }
+    return bits;
+  });
+  run("batch attack maps", states.size(), rounds, counter, [&] {
+    batch.computeAttackMaps(ColorWhite, attacks.data());
+    return attacks.back().getBits();
+  });
+
+  return 0;
+}
@@ -0,0 +1,118 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+//
+// Movetext tokenizer throughput over a synthetic PGN file: random games written out with move
+// numbers, comments, variations and annotation glyphs, as found in annotated databases.
+//
+// The lexer only depends on the text it is given, so this measures it alone, without any board
+// replay. Build with CHESSGEN_AVX2 on and off to compare the AVX2 and SSE2 classifiers.
+//
+
+#include <chessgen/board.hpp>
+#include <chessgen/pgn_lexer.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace chessgen;
+
+namespace
+{
+// -------------------------------------------------------------------------------------------------
+std::string makeMovetext(std::size_t bytes)
+{
+  auto text = std::string{};
+  auto seed = std::uint64_t{0x2545f4914f6cdd1dULL};
+  auto next = [&seed] {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+  };
+
+  while (text.size() < bytes) {
+    auto board = Board{};
+    for (auto ply = 0; ply < 120 && !board.isOver(); ++ply) {
+      if (ply % 2 == 0) {
+        text += std::to_string(ply / 2 + 1) + ". ";
+      }
+
+      auto const sans   = board.getLegalMovesAsSAN();
+      auto const choice = next() % sans.size();
+      text += sans[choice];
+      text += ' ';
+
+      switch (next() % 16) {
+        case 0: text += "{a short remark about the position} "; break;
+        case 1: text += "(" + sans[(choice + 1) % sans.size()] + " {or this}) "; break;
+        case 2: text += "$1 "; break;
+        case 3: text += "\n"; break;
+        default: break;
+      }
+      board.makeMove(board.getLegalMoves()[choice]);
+    }
+    text += "*\n\n";
+  }
+  return text;
+}
+}  // namespace
+
+// -------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  auto const megabytes = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1])) : std::size_t{16};
+  auto const rounds    = argc > 2 ? std::atoi(argv[2]) : 10;
+
+  auto const text = makeMovetext(megabytes << 20);
+
+  auto tokens      = std::uint64_t{0};
+  auto checksum    = std::uint64_t{0};
+  auto const begin = std::chrono::steady_clock::now();
+  for (auto round = 0; round < rounds; ++round) {
+    // Games end at their termination marker, start a new lexer after each one
+    auto rest = std::string_view{text};
+    while (!rest.empty()) {
+      auto lexer = MovetextLexer{rest};
+      auto token = std::string_view{};
+      while (lexer.next(token)) {
+        ++tokens;
+        checksum += token.size();
+      }
+
+      auto const result = lexer.getResult();
+      if (result.empty()) break;
+      rest.remove_prefix(static_cast<std::size_t>(result.data() + result.size() - rest.data()));
+    }
+  }
+  auto const end = std::chrono::steady_clock::now();
+
+  auto const seconds = std::chrono::duration<double>(end - begin).count();
+  auto const total   = static_cast<double>(text.size()) * rounds;
+
+  std::printf("%zu bytes of movetext, %d rounds\n", text.size(), rounds);
+  std::printf("movetext lexer %10.1f MB/s %10.1f Mtokens/s  (checksum %llu)\n",
+              total / seconds / 1e6, static_cast<double>(tokens) / seconds / 1e6,
+              static_cast<unsigned long long>(checksum));
+  return 0;
+}
@@ -0,0 +1,93 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace chessgen
+{
+/**
+ * @brief A bump allocator for memory that is all released at once
+ *
+ * Meant for per-request work: build boards and move lists on the arena, then reset() it when
+ * the request is done. Deallocation is a no-op and reset() keeps the blocks, so once the arena
+ * has grown to the size of a typical request it stops asking its upstream for memory.
+ * std::pmr::monotonic_buffer_resource instead gives its blocks back on release().
+ *
+ * Not thread-safe. Boards on an arena should be SingleThreadBoard, or only be read by one
+ * thread at a time.
+ */
+class ArenaResource : public std::pmr::memory_resource
+{
+public:
+  static constexpr std::size_t DefaultBlockSize = 64 * 1024;
+
+  explicit ArenaResource(std::size_t                blockSize = DefaultBlockSize,
+                         std::pmr::memory_resource* upstream  = std::pmr::new_delete_resource());
+  ArenaResource(ArenaResource const&) = delete;
+  ArenaResource& operator=(ArenaResource const&) = delete;
+  ~ArenaResource() override;
+
+  /**
+   * @brief Invalidates everything allocated so far. The blocks are kept for reuse
+   */
+  void reset();
+
+  /**
+   * @brief Invalidates everything allocated so far and returns the blocks upstream
+   */
+  void release();
+
+  /**
+   * @brief Bytes handed out since the last reset, including alignment padding
+   */
+  std::size_t getBytesUsed() const;
+
+  /**
+   * @brief Total size of the blocks held
+   */
+  std::size_t getCapacity() const;
+
+private:
+  struct Block {
+    char*       data;
+    std::size_t size;
+  };
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void  do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+  bool  do_is_equal(std::pmr::memory_resource const& other) const noexcept override;
+
+  bool startBlock(std::size_t index, std::size_t bytes, std::size_t alignment);
+
+  std::pmr::memory_resource* mUpstream;
+  std::size_t                mBlockSize;
+  std::vector<Block>         mBlocks;
+  std::size_t                mCurrent{0};
+  char*                      mNext{nullptr};
+  char*                      mEnd{nullptr};
+  std::size_t                mUsedBefore{0};
+};
+}  // namespace chessgen
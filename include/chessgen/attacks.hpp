@@ -28,8 +28,24 @@ namespace chessgen
 namespace attacks
 {
 void     precomputeTables();
-Bitboard getLineBetween(Square s1, Square s2);
+bool     usesHugePages();
 Bitboard getNonSlidingAttacks(Piece piece, Square from, Color color);
 Bitboard getSlidingAttacks(Piece piece, Square from, Bitboard blockers);
+
+// Lines through two squares. Squares that do not share a rank, file or diagonal give an empty set
+Bitboard getLine(Square s1, Square s2);     ///< Whole line, edge to edge, both squares included
+Bitboard getBetween(Square s1, Square s2);  ///< Only the squares strictly between the two
+bool     aligned(Square s1, Square s2, Square s3);  ///< Whether s3 lies on the line through s1 and s2
+
+// Same as getLine. Kept for existing callers, the name predates getBetween
+Bitboard getLineBetween(Square s1, Square s2);
+
+// Set-wise attacks: the union of the attacks of every piece in the given set
+Bitboard getPawnAttacks(Color color, Bitboard pawns);
+Bitboard getKnightAttacks(Bitboard knights);
+Bitboard getKingAttacks(Bitboard kings);
+Bitboard getBishopAttacks(Bitboard bishops, Bitboard occupied);
+Bitboard getRookAttacks(Bitboard rooks, Bitboard occupied);
+Bitboard getSliderAttacks(Bitboard rooks, Bitboard bishops, Bitboard occupied);
 }  // namespace attacks
 }  // namespace chessgen
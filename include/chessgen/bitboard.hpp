@@ -60,6 +60,7 @@ class Bitboard
   constexpr Bitboard& operator^=(Square s);
 
   constexpr Bitboard shiftTowards(Direction d) const;
+  constexpr Bitboard occludedFill(Direction d, Bitboard empty) const;
   std::string        prettyPrint() const;
 
   constexpr std::uint64_t getBits() const
@@ -261,6 +262,59 @@ constexpr Bitboard Rank7       = Rank1 << (8 * 6);
 constexpr Bitboard Rank8       = Rank1 << (8 * 7);
 }  // namespace Bitboards
 
+namespace detail
+{
+/**
+ * @brief How far the bits move when shifting one step towards the given direction
+ */
+constexpr int directionDelta(Direction d)
+{
+  switch (d) {
+    // clang-format off
+    case Direction::North:     return  8;
+    case Direction::South:     return -8;
+    case Direction::East:      return  1;
+    case Direction::West:      return -1;
+    case Direction::NorthEast: return  9;
+    case Direction::NorthWest: return  7;
+    case Direction::SouthEast: return -7;
+    case Direction::SouthWest: return -9;
+    // clang-format on
+    case Direction::Count:
+    default:
+      return 0;
+  }
+}
+/**
+ * @brief Squares that can be reached by a one step shift towards the given direction without
+ * wrapping around the board edge
+ */
+constexpr Bitboard directionWrapMask(Direction d)
+{
+  switch (d) {
+    case Direction::East:
+    case Direction::NorthEast:
+    case Direction::SouthEast:
+      return ~Bitboards::FileA;
+    case Direction::West:
+    case Direction::NorthWest:
+    case Direction::SouthWest:
+      return ~Bitboards::FileH;
+    case Direction::North:
+    case Direction::South:
+      return Bitboards::AllSquares;
+    case Direction::Count:
+    default:
+      return Bitboard{};
+  }
+}
+constexpr Bitboard shiftBy(Bitboard bb, int delta)
+{
+  return delta > 0 ? bb << static_cast<std::uint32_t>(delta)
+                   : bb >> static_cast<std::uint32_t>(-delta);
+}
+}  // namespace detail
+
 constexpr Bitboard Bitboard::shiftTowards(Direction d) const
 {
   switch (d) {
@@ -285,4 +339,23 @@ constexpr Bitboard Bitboard::shiftTowards(Direction d) const
       return Bitboard{};
   }
 }
+/**
+ * @brief Kogge-Stone occluded fill. Every set bit slides towards the given direction for as long
+ * as it finds empty squares. The result includes the original bits but not the first blocker,
+ * shifting it once more with shiftTowards gives the sliding attacks of the whole set.
+ */
+constexpr Bitboard Bitboard::occludedFill(Direction d, Bitboard empty) const
+{
+  auto const delta = detail::directionDelta(d);
+  auto       gen   = *this;
+  auto       pro   = empty & detail::directionWrapMask(d);
+
+  gen |= pro & detail::shiftBy(gen, delta);
+  pro &= detail::shiftBy(pro, delta);
+  gen |= pro & detail::shiftBy(gen, 2 * delta);
+  pro &= detail::shiftBy(pro, 2 * delta);
+  gen |= pro & detail::shiftBy(gen, 4 * delta);
+
+  return gen;
+}
 }  // namespace chessgen
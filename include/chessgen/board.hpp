@@ -22,8 +22,8 @@
 #pragma once
 
 #include <array>
-#include <atomic>
-#include <mutex>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
 #include <type_traits>
@@ -33,12 +33,27 @@
 #include "bitboard.hpp"
 #include "board_state.hpp"
 #include "config.hpp"
+#include "game_history.hpp"
+#include "move_cache.hpp"
 #include "san.hpp"
+#include "snapshot.hpp"
 #include "ucimove.hpp"
 
 namespace chessgen
 {
-class Board
+/**
+ * @brief A game of chess: the current position, its history and its legal moves
+ *
+ * The MoveCache policy decides how the lazily generated legal move list is shared between
+ * threads, see move_cache.hpp. Use Board for boards that are queried from several threads at
+ * once and SingleThreadBoard for everything else.
+ *
+ * Everything a board allocates (history, legal move lists, undo stack) comes from the memory
+ * resource it was constructed with. Copies share the history of the original and allocate from
+ * the same resource, which must outlive them all.
+ */
+template <typename MoveCache>
+class BasicBoard
 {
 public:
   struct GameState {
@@ -50,34 +65,51 @@ class Board
     std::optional<UCIMove> movePlayed;
   };
 
-  Board(Board const&);
-  Board(Board&&) noexcept;
-  Board& operator=(Board const&);
-  Board& operator=(Board&&) noexcept;
+  BasicBoard(BasicBoard const&);
+  BasicBoard(BasicBoard&&) noexcept;
+  BasicBoard& operator=(BasicBoard const&);
+  BasicBoard& operator=(BasicBoard&&) noexcept;
 
 public:
   /**
    * @brief Constructs a board in the default initial position
    */
-  explicit Board(ChessVariant variant = ChessVariant::Standard);
+  explicit BasicBoard(ChessVariant               variant  = ChessVariant::Standard,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
   /**
    * @brief Constructs a board in the given position
    */
-  explicit Board(std::string_view initialFen, ChessVariant variant = ChessVariant::Standard);
+  explicit BasicBoard(std::string_view           initialFen,
+                      ChessVariant               variant  = ChessVariant::Standard,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
   /**
    * @brief Constructs a board from a saved state
    */
-  explicit Board(BoardState const& state);
+  explicit BasicBoard(BoardState const&          state,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
   void        loadFen(std::string_view fen, ChessVariant variant = ChessVariant::Standard);
+
+  /**
+   * @brief Starts a new game from the given position
+   *
+   * Unlike loadFen there is nothing to parse, and the board keeps the storage it already has:
+   * the newest history chunk, the undo stack and one legal move list are reused, so resetting
+   * a board that has played a game before does not allocate.
+   *
+   * Like the BoardState constructor, it leaves the board with the standard variant and the
+   * default history checkpoint interval, whatever the previous game used.
+   */
+  void reset(BoardState const& state);
+
   std::string getFen() const;
   std::string prettyPrint(bool useUnicodeChars = true) const;
 
-  std::vector<UCIMove> const& getLegalMoves() const;
-  std::vector<std::string>    getLegalMovesAsSAN() const;
-  std::vector<UCIMove>        getLegalMovesForSquare(Square square) const;
+  MoveList const&          getLegalMoves() const;
+  std::vector<std::string> getLegalMovesAsSAN() const;
+  MoveList                 getLegalMovesForSquare(Square square) const;
 
   bool isValid(std::string_view move) const;
   bool isValid(Square from, Square to) const;
@@ -91,6 +123,35 @@ class Board
   bool makeMove(SANMove const& move);
   bool makeMove(UCIMove const& move);
 
+  /**
+   * @brief Takes back the last move. Returns false if no move has been played
+   *
+   * Legal moves of the last few plies stay cached, and replaying the move that was just taken
+   * back reuses its position, so stepping back and forth through a game is cheap.
+   */
+  bool undoMove();
+
+  /**
+   * @brief Takes back up to count moves. Returns how many were taken back
+   */
+  std::size_t undoMoves(std::size_t count);
+
+  /**
+   * @brief Captures the current position, history and legal moves for other threads to read
+   *
+   * Meant to be handed to a SnapshotPublisher after each move. The history is shared with the
+   * board, so this costs one legal move list copy and a FEN.
+   */
+  PositionSnapshot createSnapshot() const;
+
+  /**
+   * @brief Resolves a SAN move to a legal move, without throwing
+   *
+   * Returns nothing if the move is malformed or not legal in the current position. Meant for
+   * bulk PGN ingestion, where malformed tokens are common.
+   */
+  std::optional<UCIMove> trySanToUci(std::string_view move) const;
+
   ChessVariant                  getVariant() const;
   UCIMove                       sanToUci(std::string_view move) const;
   std::string                   getSanForMove(UCIMove const& move) const;
@@ -102,7 +163,13 @@ class Board
   GameOverReason                getGameOverReason() const;
   bool                          isInCheck() const;
   BoardState const&             getState() const;
-  std::vector<GameState> const& getGameHistory() const;
+  std::vector<GameState>        getGameHistory() const;
+  GameHistory const&            getHistory() const;
+  std::size_t                   getHistorySize() const;
+  BoardState                    getStateAt(std::size_t ply) const;
+  UCIMove                       getMoveAt(std::size_t ply) const;
+  void                          setHistoryCheckpointInterval(int plies);
+  std::pmr::memory_resource*    getMemoryResource() const;
   bool                          canShortCastle(Color color) const;
   bool                          canLongCastle(Color color) const;
   Bitboard                      getPieces(Piece type) const;
@@ -116,11 +183,17 @@ class Board
   bool                          isSquareUnderAttack(Color enemy, Square square) const;
 
 private:
+  bool resolveSan(SANMove const& move, UCIMove& out) const;
+  void playMove(UCIMove const& move);
   bool isInsufficientMaterial() const;
   bool isThreefold() const;
   bool isStalemate() const;
   bool isCheckmate() const;
   void gameOverCheck();
+  void clearMoveCache();
+  void stashLegalMoves();
+  void restoreLegalMoves();
+  void recycleMoves(MoveListPtr moves);
 
   template <typename Fn>
   auto findMoveIf(Fn f) const -> std::optional<UCIMove>
@@ -133,11 +206,31 @@ class Board
     return std::nullopt;
   }
 
-  std::vector<GameState>              mStates;
-  GameOverReason                      mReason{GameOverReason::OnGoing};
-  ChessVariant                        mVariant{ChessVariant::Standard};
-  mutable std::vector<UCIMove>        mLegalMoves;
-  mutable std::atomic_bool            mBoardChanged{true};
-  mutable std::mutex                  mMovesMutex{};
+  // Legal moves of a ply of the current line other than the last one
+  struct CachedMoves {
+    std::size_t ply;
+    MoveListPtr moves;
+  };
+  // A move that was taken back and the position it led to
+  struct UndoneMove {
+    UCIMove    move;
+    BoardState state;
+  };
+
+  static constexpr std::size_t MoveCacheSize = 32;
+
+  GameHistory                   mHistory;
+  std::pmr::vector<UndoneMove>  mUndone;
+  std::pmr::vector<CachedMoves> mMoveCache;
+  std::pmr::vector<MoveListPtr> mFreeMoves;  // Cleared lists, reused before allocating new ones
+  MoveCache                     mLegalMoves;
+  GameOverReason                mReason{GameOverReason::OnGoing};
+  ChessVariant                  mVariant{ChessVariant::Standard};
 };
+
+extern template class BasicBoard<LockFreeMoveCache>;
+extern template class BasicBoard<UnsynchronizedMoveCache>;
+
+using Board             = BasicBoard<LockFreeMoveCache>;
+using SingleThreadBoard = BasicBoard<UnsynchronizedMoveCache>;
 }  // namespace chessgen
@@ -0,0 +1,86 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "board.hpp"
+
+namespace chessgen
+{
+/**
+ * @brief Recycles boards for callers that start many short games
+ *
+ * acquire() hands out a board in the requested position. Released boards are kept (up to
+ * maxIdle) and reused through BasicBoard::reset, so a pool that has warmed up neither parses
+ * FENs nor allocates when handing out boards. Thread-safe; the pool must outlive its handles.
+ */
+template <typename MoveCache>
+class BasicBoardPool
+{
+public:
+  using BoardType = BasicBoard<MoveCache>;
+
+  struct Releaser {
+    void operator()(BoardType* board) const;
+
+    BasicBoardPool* pool;
+  };
+  using Handle = std::unique_ptr<BoardType, Releaser>;
+
+  static constexpr std::size_t DefaultMaxIdle = 64;
+
+  explicit BasicBoardPool(std::size_t maxIdle = DefaultMaxIdle);
+  BasicBoardPool(BasicBoardPool const&) = delete;
+  BasicBoardPool& operator=(BasicBoardPool const&) = delete;
+
+  /**
+   * @brief A board in the initial position
+   */
+  Handle acquire();
+
+  /**
+   * @brief A board in the given position
+   */
+  Handle acquire(BoardState const& state);
+
+  std::size_t getIdleCount() const;
+
+private:
+  void release(BoardType* board);
+
+  BoardState                              mInitial;
+  std::size_t                             mMaxIdle;
+  mutable std::mutex                      mMutex;
+  std::vector<std::unique_ptr<BoardType>> mIdle;
+};
+
+extern template class BasicBoardPool<LockFreeMoveCache>;
+extern template class BasicBoardPool<UnsynchronizedMoveCache>;
+
+using BoardPool             = BasicBoardPool<LockFreeMoveCache>;
+using SingleThreadBoardPool = BasicBoardPool<UnsynchronizedMoveCache>;
+}  // namespace chessgen
@@ -22,9 +22,12 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 
 #include "bitboard.hpp"
+#include "san.hpp"
 #include "types.hpp"
 #include "ucimove.hpp"
 
@@ -35,15 +38,87 @@ struct PieceInfo {
   Color color;
 };
 
+/**
+ * @brief Why a FEN string was rejected. The value names the first field that failed
+ */
+enum class FenError {
+  None,
+  PiecePlacement,
+  ActiveColor,
+  Castling,
+  EnPassant,
+  HalfMoves,
+  FullMove,
+  FieldCount,  // Neither 4 nor 6 fields
+  UnsupportedVariant,
+};
+
+char const* to_string(FenError error);
+
+struct PerftOptions;
+
 class BoardState
 {
-  friend class Board;
+  template <typename>
+  friend class BasicBoard;
+  friend class GameHistory;
+  friend class PackedPosition;
+  friend class PositionBatch;
+  friend std::uint64_t perft(BoardState const&, int, PerftOptions const&);
+  friend std::size_t   parseUciMoves(std::string_view,
+                                     BoardState const&,
+                                     UCIMove*,
+                                     std::size_t,
+                                     BoardState*,
+                                     std::string_view*);
 
 public:
+  /**
+   * @brief Buffer size that fits any FEN writeFen produces, terminating NUL included
+   */
+  static constexpr std::size_t FenBufferSize = 104;
+
+  /**
+   * @brief Parses a FEN string. Throws std::runtime_error if it is malformed
+   */
   static BoardState fromFen(std::string_view view, ChessVariant variant);
 
+  /**
+   * @brief Parses a FEN string into out, without allocating or throwing
+   *
+   * Fields may be separated by any run of spaces. The half move and full move fields are
+   * optional. out is only written to on success.
+   */
+  static FenError parseFen(std::string_view fen, BoardState& out,
+                           ChessVariant variant = ChessVariant::Standard) noexcept;
+
   std::string getFen() const;
+
+  /**
+   * @brief Writes the FEN of the position and a terminating NUL to out, without allocating
+   *
+   * @returns The length of the FEN, or 0 (and nothing written) if it does not fit in capacity
+   */
+  std::size_t writeFen(char* out, std::size_t capacity) const;
   std::string getSanForMove(UCIMove const& uci) const;
+
+  /**
+   * @brief The SAN of every move in legalMoves, which must be the legal moves of this position
+   *
+   * Disambiguation and the check data are computed once for the whole list. out must have room
+   * for legalMoves.size() entries.
+   */
+  void getSanForMoves(MoveList const& legalMoves, SanText* out) const;
+
+  /**
+   * @brief The SAN of each move of a line played from this position, in one forward pass
+   *
+   * Each move must be legal in the position the previous ones lead to. Disambiguation comes
+   * from the attack tables and only checking moves generate the replies that tell check from
+   * mate, so no other move generation is done. out must have room for count entries.
+   */
+  void getSanForLine(UCIMove const* moves, std::size_t count, SanText* out) const;
+
   int         getHalfMoves() const;
   int         getFullMove() const;
   Color       getActivePlayer() const;
@@ -68,12 +143,58 @@ class BoardState
   Square      getCastlingRookSquare(Color color, CastleSide side) const;
   Square      getEnPassantSquare() const;
   bool        isSquareUnderAttack(Color enemy, Square square) const;
+  Bitboard    getAttackedSquares(Color color) const;
+  bool        givesCheck(UCIMove const& move) const;
   bool        isMoveCheck(UCIMove const& move) const;
   bool        isMoveMate(UCIMove const& move) const;
 
+  /**
+   * @brief Zobrist hash of the pieces, side to move, castling rights and en passant file
+   *
+   * Computed from scratch, at one lookup per piece, rather than kept up to date by every move.
+   */
+  std::uint64_t getHash() const;
+
+  /**
+   * @brief Finds the legal move a SAN move stands for, without generating the legal moves
+   *
+   * The candidate origins come straight from the attack tables for the piece type and target
+   * square, so only the few pieces that can reach the target are tested for legality.
+   *
+   * @returns false if no legal move matches
+   */
+  bool resolveSan(SANMove const& move, UCIMove& out) const;
+
+  /**
+   * @brief Finds the legal move that takes the piece on from to to
+   *
+   * Castling may be given as the king's move or as the king taking its rook, and en passant
+   * captures are recognized. promotedTo must be set exactly when a pawn reaches the last rank.
+   *
+   * @returns false if there is no such legal move
+   */
+  bool resolveMove(Square from, Square to, Piece promotedTo, UCIMove& out) const;
+
 private:
+  // What a move needs to be tested for check against the enemy king
+  struct CheckInfo {
+    Square   kingSquare;
+    Bitboard discoverers;               // Our pieces that block one of our sliders
+    Bitboard checkSquares[PieceCount];  // Where each piece type would attack the king from
+  };
+
+  CheckInfo getCheckInfo() const;
+  bool      resolveOrigins(Piece piece, Square to, Bitboard fromMask, Piece promotedTo,
+                           UCIMove& out) const;
+  bool      isLegalCandidate(UCIMove const& move, Piece piece) const;
+  Bitboard  getOtherOrigins(UCIMove const& move, Piece piece) const;
+  bool      givesCheck(UCIMove const& move, Piece piece, CheckInfo const& info) const;
+  void      writeSan(UCIMove const& move, Piece piece, Bitboard others, CheckInfo const& info,
+                     MoveList& scratch, SanText& out) const;
+
   void     clearEnPassant();
   void     updateNonPieceBitboards();
+  void     updateAttackMaps();
   void     addPiece(Piece type, Color color, Square square);
   void     removePiece(Piece type, Color color, Square square);
   void     movePiece(Piece type, Color color, Square from, Square to);
@@ -90,10 +211,38 @@ class BoardState
   Bitboard         mPieces[ColorCount][PieceCount]{};
   Bitboard         mAllPieces[ColorCount]{};
   Bitboard         mOccupied{};
+  Bitboard         mAttacked[ColorCount]{};
   Bitboard         mEnPassant{};
   Color            mTurn{ColorWhite};
   int              mHalfMoves{0};
   int              mFullMove{1};
   CastleSide       mCastleRights[ColorCount]{};
 };
+
+/**
+ * @brief Parses count FEN strings. Returns how many were parsed successfully
+ *
+ * states[i] receives the position of fens[i]; errors, if given, receives the outcome of each
+ * string. Every string is parsed on its own and nothing is shared, so disjoint ranges can be
+ * handed to different threads.
+ */
+std::size_t parseFens(std::string_view const* fens,
+                      BoardState*             states,
+                      FenError*               errors,
+                      std::size_t             count,
+                      ChessVariant            variant = ChessVariant::Standard);
+
+/**
+ * @brief Writes count FENs to out, each followed by a newline. No NUL is written
+ *
+ * Stops at the first FEN that does not fit. If written is given it receives the number of
+ * positions written.
+ *
+ * @returns The number of bytes written
+ */
+std::size_t writeFens(BoardState const* states,
+                      std::size_t       count,
+                      char*             out,
+                      std::size_t       capacity,
+                      std::size_t*      written = nullptr);
 }  // namespace chessgen
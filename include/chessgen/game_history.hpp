@@ -0,0 +1,119 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+#include "board_state.hpp"
+#include "ucimove.hpp"
+
+namespace chessgen
+{
+/**
+ * @brief The positions of a game, stored as the moves played plus a full BoardState every
+ * few plies
+ *
+ * Ply 0 is the initial position. Positions in between checkpoints are rebuilt on demand by
+ * replaying at most checkpointInterval - 1 moves. The latest position is always kept, so back()
+ * costs nothing. An interval of 1 keeps every position (GameHistory::Full).
+ *
+ * The history is a persistent chain of chunks, one per checkpoint, linked from the newest to the
+ * oldest. Copies share the whole chain, so copying is O(1) and two copies that diverge only
+ * allocate for the plies after the fork. A chunk is only appended to while a single history owns
+ * it; a shared chunk is copied first (at most checkpointInterval - 1 moves).
+ *
+ * Chunks are allocated from the memory resource given at construction. Copies share chunks and
+ * so keep using the same resource; it must outlive every copy.
+ */
+class GameHistory
+{
+public:
+  static constexpr int Full                      = 1;
+  static constexpr int DefaultCheckpointInterval = 16;
+
+  GameHistory();
+  explicit GameHistory(BoardState                 initial,
+                       int                        checkpointInterval = DefaultCheckpointInterval,
+                       std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+  /**
+   * @brief Number of positions, i.e. the number of moves played plus one
+   */
+  std::size_t       size() const;
+  BoardState const& back() const;
+  BoardState        getState(std::size_t ply) const;
+  UCIMove           getMove(std::size_t ply) const;
+
+  /**
+   * @brief All the moves played, in order, gathered in one pass over the chunks
+   */
+  MoveList getMoves() const;
+
+  int               getCheckpointInterval() const;
+
+  std::pmr::memory_resource* getMemoryResource() const;
+
+  /**
+   * @brief Changes the checkpoint interval, rebuilding the checkpoints of the current game
+   */
+  void setCheckpointInterval(int checkpointInterval);
+
+  /**
+   * @brief Appends a move and the position it leads to
+   */
+  void push(UCIMove const& move, BoardState const& next);
+
+  /**
+   * @brief Drops the last move. The new last position is rebuilt from its checkpoint
+   */
+  void pop();
+
+  /**
+   * @brief Starts over from a new initial position, keeping the storage of the chunks no other
+   * history shares for the plies to come
+   */
+  void reset(BoardState const& initial);
+
+private:
+  struct Chunk;
+
+  static std::uint16_t packMove(UCIMove const& move);
+  static UCIMove       unpackMove(std::uint16_t packed);
+
+  std::shared_ptr<Chunk> newChunk(BoardState const& checkpoint, std::size_t firstPly,
+                                  std::shared_ptr<Chunk> parent) const;
+  std::shared_ptr<Chunk> takeChunk(BoardState const& checkpoint, std::size_t firstPly,
+                                   std::shared_ptr<Chunk> parent);
+  Chunk const*           findChunk(std::size_t ply) const;
+  BoardState   rebuild(std::size_t ply) const;
+
+  std::pmr::memory_resource* mResource;
+  std::shared_ptr<Chunk>     mTail;
+  std::shared_ptr<Chunk>     mSpare;  // Chunks kept by reset, linked through their parent
+  BoardState                 mLast;
+  std::size_t                mSize{1};
+  int                        mInterval{DefaultCheckpointInterval};
+};
+}  // namespace chessgen
@@ -46,13 +46,12 @@ std::vector<std::basic_string<CharT>> stringSplit(
 {
   auto result = std::vector<std::basic_string<CharT>>{};
 
-  auto start = 0u;
+  auto start = std::size_t{0};
   auto end   = source.find(delimiter);
   while (end != std::basic_string_view<CharT>::npos) {
-    if (discardEmpty && end - start == 0) {
-      continue;
+    if (!discardEmpty || end != start) {
+      result.emplace_back(source.substr(start, end - start));
     }
-    result.emplace_back(source.substr(start, end - start));
     start = end + 1;
     end   = source.find(delimiter, start);
   }
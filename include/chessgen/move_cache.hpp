@@ -0,0 +1,147 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <new>
+
+#include "ucimove.hpp"
+
+namespace chessgen
+{
+/**
+ * @brief Move cache policies for BasicBoard
+ *
+ * A policy holds the legal move list of the board's current position, which const member
+ * functions fill in lazily. The policy decides whether that lazy fill may race with other
+ * const calls on the same board. Modifying a board always requires exclusive access, whatever
+ * the policy.
+ *
+ * Policies provide:
+ *   MoveList const* load() const              - the published list, or nullptr
+ *   MoveList const& publish(MoveListPtr) const - publishes a freshly generated list
+ *   MoveListPtr take()                        - removes the list (non-const callers)
+ *   void store(MoveListPtr)                   - replaces the list (non-const callers)
+ *
+ * The list is allocated from the board's memory resource. Under LockFreeMoveCache concurrent
+ * readers may allocate at the same time, so such boards need a thread-safe resource.
+ */
+
+/**
+ * @brief Frees a MoveList created by makeMoveList, through the list's own memory resource
+ */
+struct MoveListDeleter {
+  void operator()(MoveList* moves) const
+  {
+    auto const resource = moves->get_allocator().resource();
+    moves->~MoveList();
+    resource->deallocate(moves, sizeof(MoveList), alignof(MoveList));
+  }
+};
+
+using MoveListPtr = std::unique_ptr<MoveList, MoveListDeleter>;
+
+/**
+ * @brief Moves a list to the heap. The list object is allocated from the same resource as its
+ * elements, so a list built on an arena lives entirely in the arena
+ */
+inline MoveListPtr makeMoveList(MoveList&& moves)
+{
+  auto const resource = moves.get_allocator().resource();
+  auto const memory   = resource->allocate(sizeof(MoveList), alignof(MoveList));
+  return MoveListPtr{new (memory) MoveList(std::move(moves), resource)};
+}
+
+/**
+ * @brief No synchronization. One pointer per board, for boards only ever used by one thread at
+ * a time
+ */
+class UnsynchronizedMoveCache
+{
+public:
+  MoveList const* load() const
+  {
+    return mMoves.get();
+  }
+  MoveList const& publish(MoveListPtr moves) const
+  {
+    mMoves = std::move(moves);
+    return *mMoves;
+  }
+  MoveListPtr take()
+  {
+    return std::move(mMoves);
+  }
+  void store(MoveListPtr moves)
+  {
+    mMoves = std::move(moves);
+  }
+
+private:
+  mutable MoveListPtr mMoves;
+};
+
+/**
+ * @brief Lock-free publication, for boards shared between threads
+ *
+ * Readers racing on an empty cache may each generate the list; the first compare-exchange wins
+ * and the others drop their copy and return the winner's. A published list is immutable until
+ * the board is modified, so readers never wait on each other.
+ */
+class LockFreeMoveCache
+{
+public:
+  LockFreeMoveCache() = default;
+  LockFreeMoveCache(LockFreeMoveCache const&) = delete;
+  LockFreeMoveCache& operator=(LockFreeMoveCache const&) = delete;
+  ~LockFreeMoveCache()
+  {
+    MoveListPtr{mMoves.load(std::memory_order_relaxed)}.reset();
+  }
+
+  MoveList const* load() const
+  {
+    return mMoves.load(std::memory_order_acquire);
+  }
+  MoveList const& publish(MoveListPtr moves) const
+  {
+    auto expected = static_cast<MoveList*>(nullptr);
+    if (mMoves.compare_exchange_strong(expected, moves.get(), std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+      return *moves.release();
+    }
+    return *expected;
+  }
+  MoveListPtr take()
+  {
+    return MoveListPtr{mMoves.exchange(nullptr, std::memory_order_acq_rel)};
+  }
+  void store(MoveListPtr moves)
+  {
+    MoveListPtr{mMoves.exchange(moves.release(), std::memory_order_acq_rel)}.reset();
+  }
+
+private:
+  mutable std::atomic<MoveList*> mMoves{nullptr};
+};
+}  // namespace chessgen
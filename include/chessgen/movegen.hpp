@@ -21,7 +21,9 @@
 
 #pragma once
 
+#include <memory_resource>
 #include <vector>
+
 #include "ucimove.hpp"
 
 namespace chessgen
@@ -39,11 +41,22 @@ enum class GenType {
 /**
  * @brief Generate a set of moves based on the given board position
  *
- * @param   board The board to generate moves for
+ * @param   board    The board to generate moves for
+ * @param   resource Where the returned list allocates from
  *
  * @returns The move list
  */
 template <GenType Type>
-auto generateMoves(BoardState const& state) -> std::vector<UCIMove>;
+auto generateMoves(BoardState const&          state,
+                   std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    -> MoveList;
+
+/**
+ * @brief Generate a set of moves, appending them to an existing list
+ *
+ * Lets callers reuse one list (and its capacity) across positions.
+ */
+template <GenType Type>
+void generateMoves(BoardState const& state, MoveList& moves);
 
 }  // namespace chessgen
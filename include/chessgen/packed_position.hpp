@@ -0,0 +1,86 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "board_state.hpp"
+
+namespace chessgen
+{
+/**
+ * @brief A position in a fixed 32 byte record, for storage and caches
+ *
+ * Layout (version 1). Multi-byte fields are little-endian whatever the host:
+ *
+ *   0..7   occupancy bitboard, bit 0 = a1
+ *   8..23  one nibble per occupied square, in ascending square order, low nibble first.
+ *          Bit 3 is the color (set for black), bits 0-2 the piece: 1 pawn, 2 knight, 3 bishop,
+ *          4 rook, 5 queen, 6 king. Nibbles past the last piece are zero
+ *   24     bit 0 black to move, bits 1-4 castling rights K, Q, k, q
+ *   25     en passant square in bits 0-5, bit 7 set if there is one
+ *   26..27 half move clock
+ *   28..29 full move number
+ *   30     format version
+ *   31     reserved, zero
+ *
+ * The layout does not depend on any enum of this library, so records stay readable by later
+ * versions. Positions with more than 32 pieces or counters above 65535 cannot be encoded.
+ */
+class PackedPosition
+{
+public:
+  static constexpr std::size_t  Size    = 32;
+  static constexpr std::uint8_t Version = 1;
+
+  PackedPosition() = default;
+  explicit PackedPosition(std::array<std::uint8_t, Size> const& bytes);
+
+  /**
+   * @brief Packs a position. Returns false, leaving out untouched, if it cannot be represented
+   */
+  static bool encode(BoardState const& state, PackedPosition& out);
+
+  /**
+   * @brief Unpacks the position. Returns false, leaving out untouched, if the record is
+   * malformed or from an unknown version
+   */
+  bool decode(BoardState& out) const;
+
+  std::array<std::uint8_t, Size> const& getBytes() const;
+
+private:
+  std::array<std::uint8_t, Size> mBytes{};
+};
+
+inline bool operator==(PackedPosition const& lhs, PackedPosition const& rhs)
+{
+  return lhs.getBytes() == rhs.getBytes();
+}
+inline bool operator!=(PackedPosition const& lhs, PackedPosition const& rhs)
+{
+  return !(lhs == rhs);
+}
+}  // namespace chessgen
@@ -0,0 +1,93 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "board_state.hpp"
+
+namespace chessgen
+{
+/**
+ * @brief Node counts of perft subtrees, keyed by position hash and depth
+ *
+ * Lock-free, so any number of threads may share one table. Each entry is two words, the count
+ * (with the depth in its low byte) and the hash xor'ed with it, written without any ordering
+ * between them. A reader only accepts an entry whose words xor back to the hash it looks for, so
+ * an entry torn by concurrent writers reads as a miss instead of as a wrong count.
+ *
+ * Entries come in buckets of four, one cache line. A store takes the entry for the same
+ * position and depth, else the one with the smallest depth, so deep subtrees stay the longest.
+ * As with any hash table the counts are only as good as the 64 bit hash: a collision goes
+ * unnoticed, which in practice is much rarer than a hardware fault.
+ */
+class PerftTable
+{
+public:
+  /**
+   * @brief Allocates a table of at most the given size, rounded down to a power of two of
+   * buckets, one bucket at least
+   */
+  explicit PerftTable(std::size_t megabytes);
+
+  PerftTable(PerftTable const&) = delete;
+  PerftTable& operator=(PerftTable const&) = delete;
+
+  std::size_t getSize() const;  ///< In bytes
+
+  bool probe(std::uint64_t hash, int depth, std::uint64_t& nodes) const;
+  void store(std::uint64_t hash, int depth, std::uint64_t nodes);
+  void clear();
+
+private:
+  struct Entry {
+    std::atomic<std::uint64_t> check;  // Hash ^ data
+    std::atomic<std::uint64_t> data;   // Nodes << 8 | depth
+  };
+  struct alignas(64) Bucket {
+    Entry entries[4];
+  };
+
+  std::unique_ptr<Bucket[]> mBuckets;
+  std::size_t               mMask;
+};
+
+struct PerftOptions {
+  bool        bulkCount{false};  // Count the legal moves at depth 1 instead of playing them
+  PerftTable* table{nullptr};    // Where subtree counts of depth 2 and more are shared
+};
+
+/**
+ * @brief Counts the leaf nodes of the legal move tree of the given depth from a position
+ *
+ * The usual way to validate a move generator against known counts. Depth 0 counts the position
+ * itself. Runs on the calling thread, one move list per ply is reused throughout.
+ *
+ * Bulk counting skips the moves of the last ply, which are most of the work, and a table skips
+ * the subtrees of positions reached more than once. Both still generate every move they count.
+ */
+std::uint64_t perft(BoardState const& state, int depth, PerftOptions const& options = {});
+}  // namespace chessgen
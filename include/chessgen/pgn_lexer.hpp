@@ -0,0 +1,76 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace chessgen
+{
+/**
+ * @brief Splits PGN movetext into SAN tokens, without copying
+ *
+ * Comments ("{...}" and ";" to the end of the line), variations (nested parentheses), NAGs
+ * ("$12"), move numbers ("12." and "12...") and "%" escape lines are skipped. The game
+ * termination marker ends the movetext. Tokens point into the text given to the constructor.
+ *
+ * The text is classified 64 bytes at a time into bit masks of white space and of characters
+ * that end a token, with AVX2 or SSE2 when available (see CHESSGEN_AVX2). Token boundaries are
+ * then found with bit scans, so each byte is looked at once however short the tokens are.
+ * Any byte up to and including ' ' counts as white space.
+ */
+class MovetextLexer
+{
+public:
+  explicit MovetextLexer(std::string_view movetext);
+
+  /**
+   * @brief Reads the next SAN token. Returns false at the termination marker or the end of the
+   * movetext
+   */
+  bool next(std::string_view& token);
+
+  /**
+   * @brief The termination marker ("1-0", "0-1", "1/2-1/2" or "*") once next returned false,
+   * empty if the movetext ended without one
+   */
+  std::string_view getResult() const;
+
+private:
+  void        classify(std::size_t pos);
+  std::size_t skipSpaces(std::size_t pos);
+  std::size_t findStop(std::size_t pos);
+  std::size_t findSpecial(std::size_t pos);
+  void        skipLine();
+  void        skipComment();
+  void        skipVariation();
+
+  std::string_view mText;
+  std::size_t      mPos{0};
+  std::string_view mResult;
+  std::size_t      mBlock{~std::size_t{0}};  // Offset of the classified block
+  std::uint64_t    mSpaces{0};               // White space in the block, one bit per byte
+  std::uint64_t    mStops{0};                // White space and characters that end a token
+};
+}  // namespace chessgen
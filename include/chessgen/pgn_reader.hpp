@@ -0,0 +1,105 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "board.hpp"
+
+namespace chessgen
+{
+/**
+ * @brief Why the replay of a game stopped early
+ */
+enum class PgnError {
+  None,
+  Tag,   // Malformed tag pair
+  Fen,   // Invalid FEN tag
+  Move,  // Malformed or illegal move
+};
+
+char const* to_string(PgnError error);
+
+struct PgnTag {
+  std::string_view name;
+  std::string_view value;  // Without the quotes, \" and \\ unescaped
+};
+
+/**
+ * @brief A game as replayed by a PGN reader worker
+ *
+ * The views point into the PGN text. Each worker reuses one PgnGame for all of its games, so
+ * anything needed after the callback returns has to be copied out.
+ */
+struct PgnGame {
+  std::size_t         index{0};  // Position of the game in the input, from 0
+  std::string_view    text;      // The whole game, tags included
+  std::vector<PgnTag> tags;
+  MoveList            moves;   // The moves replayed, up to the first error
+  std::string_view    result;  // Termination marker, empty if there was none
+  PgnError            error{PgnError::None};
+  std::string_view    errorToken;  // The offending tag line or move
+  std::string         tagText;     // Backs the tag values that had to be unescaped
+
+  std::string_view getTag(std::string_view name) const;
+};
+
+/**
+ * @brief Receives each game along with the worker's board, which holds the position after the
+ * last move replayed: the final position, or the one the first error occurred in
+ *
+ * Called from the worker threads, concurrently and in no particular order.
+ */
+using PgnCallback = std::function<void(PgnGame const& game, SingleThreadBoard const& board)>;
+
+struct PgnReadOptions {
+  unsigned    threads{0};      // Worker threads, 0 for one per hardware thread
+  std::size_t batchGames{64};  // Games handed to a worker at a time
+};
+
+/**
+ * @brief Replays every game in a PGN text on a pool of worker threads
+ *
+ * The calling thread splits the text at game boundaries while the workers replay the games,
+ * each on a board of its own that is reset, not rebuilt, between games. An exception thrown by
+ * the callback stops the workers and is rethrown here.
+ *
+ * @returns The number of games
+ */
+std::size_t readPgn(std::string_view      text,
+                    PgnCallback const&    callback,
+                    PgnReadOptions const& options = {});
+
+/**
+ * @brief Same as readPgn, over a file that is memory-mapped rather than read
+ *
+ * Throws std::runtime_error if the file cannot be opened.
+ */
+std::size_t readPgnFile(std::string const&    path,
+                        PgnCallback const&    callback,
+                        PgnReadOptions const& options = {});
+}  // namespace chessgen
@@ -0,0 +1,72 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "game_history.hpp"
+#include "pgn_reader.hpp"
+
+namespace chessgen
+{
+struct PgnWriteOptions {
+  std::size_t lineWidth{80};  // Longest movetext line. PGN allows up to 255
+};
+
+/**
+ * @brief The termination marker for a game: "1-0", "0-1", "1/2-1/2", or "*" while it goes on
+ *
+ * sideToMove is the player to move in the final position, the one that was mated on a Mate.
+ */
+char const* getPgnResult(GameOverReason reason, Color sideToMove);
+
+/**
+ * @brief Writes a game in PGN export format, appending it to out
+ *
+ * The tags come first, in the order given. Values are given raw, as PgnGame hands them out, and
+ * the writer escapes the quotes and backslashes in them. A Result tag is added if there is none,
+ * and SetUp and FEN tags if the game does not start from the initial position and has no FEN
+ * tag. The movetext follows, wrapped at options.lineWidth, then
+ * the result ("*" if empty) and a blank line.
+ *
+ * The SAN of the whole game is generated in one forward pass over the history.
+ */
+void writePgn(GameHistory const&         history,
+              std::vector<PgnTag> const& tags,
+              std::string_view           result,
+              std::string&               out,
+              PgnWriteOptions const&     options = {});
+
+/**
+ * @brief Same as above, writing to a stream a line at a time
+ */
+void writePgn(GameHistory const&         history,
+              std::vector<PgnTag> const& tags,
+              std::string_view           result,
+              std::ostream&              out,
+              PgnWriteOptions const&     options = {});
+}  // namespace chessgen
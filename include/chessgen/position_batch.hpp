@@ -0,0 +1,96 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.hpp"
+#include "board_state.hpp"
+#include "types.hpp"
+
+namespace chessgen
+{
+namespace detail
+{
+struct BatchColumns;
+}
+
+/**
+ * @brief A structure-of-arrays container for many independent positions
+ *
+ * Every bitboard kind is kept in its own contiguous array so the kernels below can process
+ * several positions per instruction (4 with AVX2, 8 with AVX-512, see CHESSGEN_AVX2 and
+ * CHESSGEN_AVX512). Builds without those fall back to a scalar loop over the same code.
+ *
+ * The kernels write one result per position into caller provided arrays, which must hold at
+ * least size() elements.
+ */
+class PositionBatch
+{
+public:
+  PositionBatch() = default;
+  explicit PositionBatch(std::size_t capacity);
+
+  void        reserve(std::size_t capacity);
+  void        clear();
+  std::size_t size() const;
+  bool        empty() const;
+  void        push_back(BoardState const& state);
+  BoardState  getState(std::size_t index) const;
+  Bitboard    getPieces(std::size_t index, Color color, Piece type) const;
+  Color       getActivePlayer(std::size_t index) const;
+
+  /**
+   * @brief Squares attacked by the given color in every position. Same semantics as
+   * BoardState::getAttackedSquares
+   */
+  void computeAttackMaps(Color color, Bitboard* out) const;
+
+  /**
+   * @brief Pieces giving check to the side to move in every position
+   */
+  void computeCheckers(Bitboard* out) const;
+
+  /**
+   * @brief Whether the side to move is in check, 1 or 0 for every position
+   */
+  void computeInCheck(std::uint8_t* out) const;
+
+  /**
+   * @brief Number of legal moves for the side to move in every position
+   */
+  void countLegalMoves(int* out) const;
+
+private:
+  detail::BatchColumns getColumns() const;
+
+  std::vector<std::uint64_t> mPieces[ColorCount][PieceCount];
+  std::vector<std::uint64_t> mAllPieces[ColorCount];
+  std::vector<std::uint64_t> mEnPassant;
+  std::vector<std::uint64_t> mWhiteToMove;  ///< All ones when white is to move, used as a mask
+  std::vector<std::uint8_t>  mCastleRights;
+  std::vector<int>           mHalfMoves;
+  std::vector<int>           mFullMove;
+};
+}  // namespace chessgen
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <string>
 #include <string_view>
@@ -29,12 +30,51 @@
 
 namespace chessgen
 {
+/**
+ * @brief A SAN string in a fixed buffer. The longest SAN moves ("Qa1xb2#", "exd8=Q+") are 7
+ * characters long
+ */
+struct SanText {
+  char         chars[8]{};
+  std::uint8_t length{0};
+
+  std::string_view view() const { return {chars, length}; }
+};
+
+/**
+ * @brief Why a SAN move was rejected
+ */
+enum class SanError {
+  None,
+  Empty,
+  Castling,
+  Piece,
+  Square,
+  Capture,
+  Disambiguation,
+  Promotion,
+  TrailingCharacters,
+};
+
+char const* to_string(SanError error);
+
 class SANMove
 {
 public:
   SANMove() = default;
 
+  /**
+   * @brief Parses a SAN move. Throws std::runtime_error if it is malformed
+   */
   static SANMove parse(std::string_view movetext);
+
+  /**
+   * @brief Parses a SAN move into out in a single pass, without allocating or throwing
+   *
+   * Check and mate marks, annotation glyphs ("!", "?") and a trailing "e.p." are accepted and
+   * ignored. out is only written to on success.
+   */
+  static SanError tryParse(std::string_view movetext, SANMove& out) noexcept;
   
   Piece  piece() const { return mPiece; }
   Square toSquare() const { return mToSquare; }
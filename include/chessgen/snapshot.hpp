@@ -0,0 +1,126 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "board_state.hpp"
+#include "game_history.hpp"
+#include "types.hpp"
+#include "ucimove.hpp"
+
+namespace chessgen
+{
+/**
+ * @brief An immutable view of a game at one point in time
+ *
+ * Everything a reader usually asks for is computed when the snapshot is created, so reading a
+ * snapshot never generates moves or touches the board it was taken from.
+ */
+class PositionSnapshot
+{
+public:
+  PositionSnapshot(GameHistory history, MoveList legalMoves, GameOverReason reason);
+
+  BoardState const&  getState() const;
+  GameHistory const& getHistory() const;
+  MoveList const&    getLegalMoves() const;
+  std::string const& getFen() const;
+  GameOverReason     getGameOverReason() const;
+  std::size_t        getHistorySize() const;
+
+private:
+  GameHistory    mHistory;
+  MoveList       mLegalMoves;
+  std::string    mFen;
+  GameOverReason mReason;
+};
+
+/**
+ * @brief Publishes the latest PositionSnapshot of a game to any number of reader threads
+ *
+ * A single writer calls publish() after each move; readers call acquire() and keep the returned
+ * handle for as long as they need the snapshot. acquire() is one fetch_add on the published word.
+ * Every few thousand reads a reader also folds the pending acquires into the snapshot with a
+ * compare-exchange, retried until it or another reader gets it done. Readers never block the
+ * writer or each other, and a snapshot is freed when the last handle to it goes away.
+ *
+ * The published word packs the snapshot pointer (low 48 bits) with the number of acquire() calls
+ * made since it was published (high 16 bits). publish() throws std::runtime_error on a platform
+ * whose addresses do not fit in 48 bits. Each snapshot also has its own count, biased while
+ * published, which handles decrement on release. Retiring a snapshot moves the acquire count
+ * into the snapshot's count and removes the bias, leaving it equal to the live handles.
+ */
+class SnapshotPublisher
+{
+  struct Node;
+
+public:
+  /**
+   * @brief A reference to a published snapshot
+   */
+  class Handle
+  {
+  public:
+    Handle() = default;
+    Handle(Handle const& other);
+    Handle(Handle&& other) noexcept;
+    Handle& operator=(Handle other) noexcept;
+    ~Handle();
+
+    PositionSnapshot const& operator*() const;
+    PositionSnapshot const* operator->() const;
+    explicit                operator bool() const;
+
+  private:
+    friend class SnapshotPublisher;
+    explicit Handle(Node* node);
+
+    Node* mNode{nullptr};
+  };
+
+  SnapshotPublisher() = default;
+  SnapshotPublisher(SnapshotPublisher const&) = delete;
+  SnapshotPublisher& operator=(SnapshotPublisher const&) = delete;
+  ~SnapshotPublisher();
+
+  /**
+   * @brief Replaces the published snapshot. Only one thread may publish at a time
+   */
+  void publish(PositionSnapshot snapshot);
+
+  /**
+   * @brief The latest snapshot, or an empty handle if nothing was published yet
+   */
+  Handle acquire() const;
+
+private:
+  static void retire(std::uint64_t word);
+  static void release(Node* node);
+
+  mutable std::atomic<std::uint64_t> mWord{0};
+};
+}  // namespace chessgen
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "types.hpp"
 
 namespace chessgen
@@ -61,4 +67,87 @@ class UCIMove
   Piece      mPromotedTo{PieceNone};
   bool       mEnPassant{false};
 };
+
+inline bool operator==(UCIMove const& lhs, UCIMove const& rhs)
+{
+  return lhs.fromSquare() == rhs.fromSquare() && lhs.toSquare() == rhs.toSquare() &&
+         lhs.getCastleSide() == rhs.getCastleSide() && lhs.promotedTo() == rhs.promotedTo() &&
+         lhs.isEnPassant() == rhs.isEnPassant();
+}
+inline bool operator!=(UCIMove const& lhs, UCIMove const& rhs)
+{
+  return !(lhs == rhs);
+}
+
+/**
+ * @brief A list of moves. Allocates from the memory resource it was created with, the default
+ * resource unless told otherwise
+ */
+using MoveList = std::pmr::vector<UCIMove>;
+
+/**
+ * @brief The most legal moves a reachable position has
+ */
+constexpr std::size_t MaxLegalMoves = 218;
+
+class BoardState;
+
+/**
+ * @brief How castling is written in UCI: as the king's own move ("e1g1"), or as the king taking
+ * its rook ("e1h1"), which is what UCI_Chess960 GUIs send
+ *
+ * Both assume the standard starting squares, king on e1/e8 and rooks in the corners. Chess960
+ * castling from other squares cannot be written.
+ */
+enum class CastlingNotation {
+  KingMove,
+  KingTakesRook,
+};
+
+/**
+ * @brief The longest UCI move, a promotion such as "e7e8q"
+ */
+constexpr std::size_t UciMoveMaxLength = 5;
+
+/**
+ * @brief Writes a move played by color in UCI long algebraic notation, without allocating
+ *
+ * out needs room for UciMoveMaxLength characters. No terminating NUL is written.
+ *
+ * @returns The number of characters written
+ */
+std::size_t writeUciMove(UCIMove const&   move,
+                         Color            color,
+                         char*            out,
+                         CastlingNotation notation = CastlingNotation::KingMove);
+std::string toUciString(UCIMove const&   move,
+                        Color            color,
+                        CastlingNotation notation = CastlingNotation::KingMove);
+
+/**
+ * @brief Parses a UCI move and finds the legal move it stands for in state
+ *
+ * Castling is accepted in both notations. Returns false if the text is malformed or the move is
+ * not legal. out is only written to on success.
+ */
+bool parseUciMove(std::string_view text, BoardState const& state, UCIMove& out);
+
+/**
+ * @brief Parses a space separated list of UCI moves played in turn from state, such as the tail
+ * of a "position ... moves" command, without allocating
+ *
+ * Stops at the first malformed or illegal move, or after capacity moves.
+ *
+ * @param end      If not null, receives the position after the last parsed move
+ * @param unparsed If not null, receives the rest of the line from the first move not parsed,
+ *                 empty if every move was
+ *
+ * @returns The number of moves written to out
+ */
+std::size_t parseUciMoves(std::string_view  line,
+                          BoardState const& state,
+                          UCIMove*          out,
+                          std::size_t       capacity,
+                          BoardState*       end      = nullptr,
+                          std::string_view* unparsed = nullptr);
 }  // namespace chessgen
@@ -0,0 +1,147 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "chessgen/arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "chessgen/platform.hpp"
+
+namespace chessgen
+{
+// Blocks grow to at most this many times the initial block size
+static constexpr std::size_t _maxGrowth = 64;
+
+// -------------------------------------------------------------------------------------------------
+ArenaResource::ArenaResource(std::size_t blockSize, std::pmr::memory_resource* upstream)
+    : mUpstream{upstream}, mBlockSize{std::max<std::size_t>(blockSize, 64)}
+{
+}
+// -------------------------------------------------------------------------------------------------
+ArenaResource::~ArenaResource()
+{
+  release();
+}
+// -------------------------------------------------------------------------------------------------
+void ArenaResource::reset()
+{
+  mCurrent    = 0;
+  mUsedBefore = 0;
+  mNext       = mBlocks.empty() ? nullptr : mBlocks.front().data;
+  mEnd        = mBlocks.empty() ? nullptr : mBlocks.front().data + mBlocks.front().size;
+}
+// -------------------------------------------------------------------------------------------------
+void ArenaResource::release()
+{
+  for (auto const& block : mBlocks) {
+    mUpstream->deallocate(block.data, block.size, alignof(std::max_align_t));
+  }
+  mBlocks.clear();
+  reset();
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t ArenaResource::getBytesUsed() const
+{
+  if (mBlocks.empty()) {
+    return 0;
+  }
+  return mUsedBefore + static_cast<std::size_t>(mNext - mBlocks[mCurrent].data);
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t ArenaResource::getCapacity() const
+{
+  auto total = std::size_t{0};
+  for (auto const& block : mBlocks) {
+    total += block.size;
+  }
+  return total;
+}
+// -------------------------------------------------------------------------------------------------
+void* ArenaResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+  CHESSGEN_ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+  auto const aligned = [&] {
+    auto const address = reinterpret_cast<std::uintptr_t>(mNext);
+    return mNext + ((alignment - address % alignment) % alignment);
+  };
+
+  // Fast path: bump within the current block
+  if (mNext && bytes <= static_cast<std::size_t>(mEnd - mNext)) {
+    auto const p = aligned();
+    if (bytes <= static_cast<std::size_t>(mEnd - p)) {
+      mNext = p + bytes;
+      return p;
+    }
+  }
+
+  // Move on to the next kept block that is big enough
+  auto const after = mBlocks.empty() ? std::size_t{0} : mCurrent + 1;
+  auto       next  = after;
+  while (next < mBlocks.size() && !startBlock(next, bytes, alignment)) {
+    ++next;
+  }
+
+  // None left, get a new one from upstream. Sizes double (up to a limit) so that an arena
+  // serving large requests settles on a few blocks
+  if (next == mBlocks.size()) {
+    auto const grown = mBlocks.empty() ? mBlockSize
+                                       : std::min(2 * mBlocks.back().size, _maxGrowth * mBlockSize);
+    auto const size  = std::max(bytes + alignment, grown);
+    auto const data  = static_cast<char*>(mUpstream->allocate(size, alignof(std::max_align_t)));
+    mBlocks.insert(mBlocks.begin() + static_cast<std::ptrdiff_t>(after), Block{data, size});
+    startBlock(after, bytes, alignment);
+  }
+
+  auto const p = aligned();
+  mNext        = p + bytes;
+  return p;
+}
+// -------------------------------------------------------------------------------------------------
+void ArenaResource::do_deallocate(void*, std::size_t, std::size_t)
+{
+  // Memory is only reclaimed by reset() and release()
+}
+// -------------------------------------------------------------------------------------------------
+bool ArenaResource::do_is_equal(std::pmr::memory_resource const& other) const noexcept
+{
+  return this == &other;
+}
+// -------------------------------------------------------------------------------------------------
+// Makes block index the current one if the request fits in it
+bool ArenaResource::startBlock(std::size_t index, std::size_t bytes, std::size_t alignment)
+{
+  auto const& block = mBlocks[index];
+  if (block.size < bytes + alignment) {
+    return false;
+  }
+
+  if (!mBlocks.empty() && mNext) {
+    mUsedBefore += static_cast<std::size_t>(mNext - mBlocks[mCurrent].data);
+  }
+  mCurrent = index;
+  mNext    = block.data;
+  mEnd     = block.data + block.size;
+  return true;
+}
+}  // namespace chessgen
@@ -21,6 +21,19 @@
 
 #include "chessgen/attacks.hpp"
 
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(CHESSGEN_HUGEPAGES) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
 namespace chessgen
 {
 namespace attacks
@@ -105,15 +118,33 @@ class Rays
   Bitboard mRays[int(Direction::Count)][64];
 };
 
+// The magic and line tables make up ~2.5MB that move generation hits at random. They live in a
+// single cache aligned block so that block can be backed by huge pages (see adviseTables)
+struct alignas(64) LookupTables {
+  Bitboard rook[64][4096];
+  Bitboard bishop[64][1024];
+  Bitboard line[64][64];     ///< The full edge-to-edge line through both squares, if any
+  Bitboard between[64][64];  ///< The squares strictly between both squares, if aligned
+};
+
 static Rays     _rays;
 static Bitboard _nonSlidingAttacks[2][6][64] = {};
-static Bitboard _rookTable[64][4096]         = {};
-static Bitboard _bishopTable[64][1024]       = {};
 static Bitboard _rookMasks[64]               = {};
 static Bitboard _bishopMasks[64]             = {};
-static Bitboard _libeBBs[64][64]             = {};
+static bool     _hugePages                   = false;
+
+#if defined(CHESSGEN_HUGEPAGES) && defined(__linux__)
+constexpr std::size_t _hugePageSize = std::size_t{2} * 1024 * 1024;
+
+alignas(_hugePageSize) static LookupTables _tables = {};
+#else
+static LookupTables _tables = {};
+#endif
+
+static void adviseTables();
 
 static void precomputeRays();
+static void initTables();
 static void initPawnAttacks();
 static void initKnightAttacks();
 static void initKingAttacks();
@@ -133,8 +164,16 @@ static Bitboard getRayForSquare(Direction d, int square)
 }
 
 // -------------------------------------------------------------------------------------------------
+// Safe to call any number of times and from any thread, only the first call builds the tables
 void precomputeTables()
 {
+  static std::once_flag flag;
+  std::call_once(flag, initTables);
+}
+// -------------------------------------------------------------------------------------------------
+void initTables()
+{
+  adviseTables();
   precomputeRays();
 
   initPawnAttacks();
@@ -151,15 +190,39 @@ void precomputeTables()
     for (auto&& pt : {PieceBishop, PieceRook}) {
       for (Square s2 = Square::A1; s2 <= Square::H8; ++s2) {
         if (getSlidingAttacks(pt, s1, Bitboard{}) & s2) {
-          _libeBBs[int(s1)][int(s2)] =
+          _tables.line[int(s1)][int(s2)] =
               ((getSlidingAttacks(pt, s1, Bitboard{}) & getSlidingAttacks(pt, s2, Bitboard{})) | s1) |
               s2;
+          _tables.between[int(s1)][int(s2)] =
+              getSlidingAttacks(pt, s1, Bitboard{} | s2) & getSlidingAttacks(pt, s2, Bitboard{} | s1);
         }
       }
     }
   }
 }
 // -------------------------------------------------------------------------------------------------
+bool usesHugePages()
+{
+  return _hugePages;
+}
+// -------------------------------------------------------------------------------------------------
+// With CHESSGEN_HUGEPAGES the tables are aligned to 2MB and, before anything touches them, the
+// kernel is asked to back them with transparent huge pages, so the whole block needs 2 TLB
+// entries instead of ~640. Setting the environment variable CHESSGEN_HUGEPAGES=0 skips the advice
+void adviseTables()
+{
+#if defined(CHESSGEN_HUGEPAGES) && defined(__linux__)
+  if (auto const env = std::getenv("CHESSGEN_HUGEPAGES"); env && std::strcmp(env, "0") == 0) {
+    return;
+  }
+
+  // Advice only, the tables still work on regular pages if THP is disabled system wide
+  constexpr auto pageSize = std::size_t{4096};
+  constexpr auto size     = (sizeof(LookupTables) + pageSize - 1) / pageSize * pageSize;
+  _hugePages              = madvise(&_tables, size, MADV_HUGEPAGE) == 0;
+#endif
+}
+// -------------------------------------------------------------------------------------------------
 void precomputeRays()
 {
   for (auto sq = 0; sq < 64; ++sq) {
@@ -178,10 +241,25 @@ void precomputeRays()
   }
 }
 
+// -------------------------------------------------------------------------------------------------
+Bitboard getLine(Square s1, Square s2)
+{
+  return _tables.line[int(s1)][int(s2)];
+}
+// -------------------------------------------------------------------------------------------------
+Bitboard getBetween(Square s1, Square s2)
+{
+  return _tables.between[int(s1)][int(s2)];
+}
+// -------------------------------------------------------------------------------------------------
+bool aligned(Square s1, Square s2, Square s3)
+{
+  return !!(_tables.line[int(s1)][int(s2)] & s3);
+}
 // -------------------------------------------------------------------------------------------------
 Bitboard getLineBetween(Square s1, Square s2)
 {
-  return _libeBBs[int(s1)][int(s2)];
+  return getLine(s1, s2);
 }
 // -------------------------------------------------------------------------------------------------
 Bitboard getNonSlidingAttacks(Piece piece, Square from, Color color)
@@ -207,6 +285,109 @@ Bitboard getSlidingAttacks(Piece piece, Square from, Bitboard blockers)
   }
 }
 // -------------------------------------------------------------------------------------------------
+Bitboard getPawnAttacks(Color color, Bitboard pawns)
+{
+  if (color == ColorWhite)
+    return pawns.shiftTowards(Direction::NorthEast) | pawns.shiftTowards(Direction::NorthWest);
+  else
+    return pawns.shiftTowards(Direction::SouthEast) | pawns.shiftTowards(Direction::SouthWest);
+}
+// -------------------------------------------------------------------------------------------------
+Bitboard getKnightAttacks(Bitboard knights)
+{
+  return (((knights << 15) | (knights >> 17)) & ~Bitboards::FileH) |                      // Left 1
+         (((knights >> 15) | (knights << 17)) & ~Bitboards::FileA) |                      // Right 1
+         (((knights << 6) | (knights >> 10)) & ~(Bitboards::FileG | Bitboards::FileH)) |  // Left 2
+         (((knights >> 6) | (knights << 10)) & ~(Bitboards::FileA | Bitboards::FileB));   // Right 2
+}
+// -------------------------------------------------------------------------------------------------
+Bitboard getKingAttacks(Bitboard kings)
+{
+  auto const sides = kings.shiftTowards(Direction::East) | kings.shiftTowards(Direction::West);
+  auto const row   = kings | sides;
+  return sides | row.shiftTowards(Direction::North) | row.shiftTowards(Direction::South);
+}
+// -------------------------------------------------------------------------------------------------
+#if defined(__AVX2__)
+// Shift counts for a lane walking towards d. A count of 64 or more makes the AVX2 shifts return
+// zero, so every lane gets one left and one right count and only one of them does anything
+constexpr long long leftShiftCount(Direction d, int steps)
+{
+  return detail::directionDelta(d) > 0 ? detail::directionDelta(d) * steps : 64;
+}
+constexpr long long rightShiftCount(Direction d, int steps)
+{
+  return detail::directionDelta(d) < 0 ? -detail::directionDelta(d) * steps : 64;
+}
+template <int Steps, Direction D0, Direction D1, Direction D2, Direction D3>
+static __m256i shiftLanes(__m256i x)
+{
+  auto const left  = _mm256_setr_epi64x(leftShiftCount(D0, Steps),
+                                       leftShiftCount(D1, Steps),
+                                       leftShiftCount(D2, Steps),
+                                       leftShiftCount(D3, Steps));
+  auto const right = _mm256_setr_epi64x(rightShiftCount(D0, Steps),
+                                        rightShiftCount(D1, Steps),
+                                        rightShiftCount(D2, Steps),
+                                        rightShiftCount(D3, Steps));
+  return _mm256_or_si256(_mm256_sllv_epi64(x, left), _mm256_srlv_epi64(x, right));
+}
+// The same Kogge-Stone fill as Bitboard::occludedFill, with one direction per 64 bit lane
+template <Direction D0, Direction D1, Direction D2, Direction D3>
+static Bitboard getSlidingAttacks4(Bitboard sliders, Bitboard occupied)
+{
+  auto const wrap = _mm256_setr_epi64x(detail::directionWrapMask(D0).getBits(),
+                                       detail::directionWrapMask(D1).getBits(),
+                                       detail::directionWrapMask(D2).getBits(),
+                                       detail::directionWrapMask(D3).getBits());
+
+  auto gen = _mm256_set1_epi64x(sliders.getBits());
+  auto pro = _mm256_andnot_si256(_mm256_set1_epi64x(occupied.getBits()), wrap);
+
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shiftLanes<1, D0, D1, D2, D3>(gen)));
+  pro = _mm256_and_si256(pro, shiftLanes<1, D0, D1, D2, D3>(pro));
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shiftLanes<2, D0, D1, D2, D3>(gen)));
+  pro = _mm256_and_si256(pro, shiftLanes<2, D0, D1, D2, D3>(pro));
+  gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shiftLanes<4, D0, D1, D2, D3>(gen)));
+
+  auto const attacks = _mm256_and_si256(shiftLanes<1, D0, D1, D2, D3>(gen), wrap);
+
+  // Fold the four lanes into one bitboard
+  auto folded = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+  folded      = _mm_or_si128(folded, _mm_unpackhi_epi64(folded, folded));
+  return Bitboard{static_cast<std::uint64_t>(_mm_cvtsi128_si64(folded))};
+}
+#else
+template <Direction D0, Direction D1, Direction D2, Direction D3>
+static Bitboard getSlidingAttacks4(Bitboard sliders, Bitboard occupied)
+{
+  auto const empty = ~occupied;
+  return sliders.occludedFill(D0, empty).shiftTowards(D0) |
+         sliders.occludedFill(D1, empty).shiftTowards(D1) |
+         sliders.occludedFill(D2, empty).shiftTowards(D2) |
+         sliders.occludedFill(D3, empty).shiftTowards(D3);
+}
+#endif
+// -------------------------------------------------------------------------------------------------
+Bitboard getBishopAttacks(Bitboard bishops, Bitboard occupied)
+{
+  return getSlidingAttacks4<Direction::NorthEast,
+                            Direction::NorthWest,
+                            Direction::SouthEast,
+                            Direction::SouthWest>(bishops, occupied);
+}
+// -------------------------------------------------------------------------------------------------
+Bitboard getRookAttacks(Bitboard rooks, Bitboard occupied)
+{
+  return getSlidingAttacks4<Direction::North, Direction::South, Direction::East, Direction::West>(
+      rooks, occupied);
+}
+// -------------------------------------------------------------------------------------------------
+Bitboard getSliderAttacks(Bitboard rooks, Bitboard bishops, Bitboard occupied)
+{
+  return getRookAttacks(rooks, occupied) | getBishopAttacks(bishops, occupied);
+}
+// -------------------------------------------------------------------------------------------------
 void initPawnAttacks()
 {
   for (int i = 0; i < 64; i++) {
@@ -258,7 +439,7 @@ void initRookMagicTable()
     for (int blockerIndex = 0; blockerIndex < (1 << magics::rookBits[square]); blockerIndex++) {
       auto const blockers = getBlockersFromIndex(blockerIndex, _rookMasks[square]);
       auto const hash = (blockers.getBits() * magics::rook[square]) >> (64 - magics::rookBits[square]);
-      _rookTable[square][hash] = getRookAttacksSlow(square, blockers);
+      _tables.rook[square][hash] = getRookAttacksSlow(square, blockers);
     }
   }
 }
@@ -272,7 +453,7 @@ void initBishopMagicTable()
       auto const blockers = getBlockersFromIndex(blockerIndex, _bishopMasks[square]);
       auto const hash =
           (blockers.getBits() * magics::bishop[square]) >> (64 - magics::bishopBits[square]);
-      _bishopTable[square][hash] = getBishopAttacksSlow(square, blockers);
+      _tables.bishop[square][hash] = getBishopAttacksSlow(square, blockers);
     }
   }
 }
@@ -346,14 +527,14 @@ Bitboard getRookAttacks(int square, Bitboard blockers)
 {
   blockers &= _rookMasks[square];
   auto const key = (blockers.getBits() * magics::rook[square]) >> (64 - magics::rookBits[square]);
-  return _rookTable[square][key];
+  return _tables.rook[square][key];
 }
 // -------------------------------------------------------------------------------------------------
 Bitboard getBishopAttacks(int square, Bitboard blockers)
 {
   blockers &= _bishopMasks[square];
   auto const key = (blockers.getBits() * magics::bishop[square]) >> (64 - magics::bishopBits[square]);
-  return _bishopTable[square][key];
+  return _tables.bishop[square][key];
 }
 // -------------------------------------------------------------------------------------------------
 Bitboard getBlockersFromIndex(int index, Bitboard blockerMask)
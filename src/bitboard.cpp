@@ -28,9 +28,7 @@ namespace chessgen
 {
 Bitboard Bitboard::getLineBetween(Square a, Square b)
 {
-  return attacks::getLineBetween(a, b) &
-         ((Bitboards::AllSquares << (int(a) + (int(a) < int(b)))) ^
-          (Bitboards::AllSquares << (int(b) + !(int(a) < int(b)))));
+  return attacks::getBetween(a, b);
 }
 std::string Bitboard::prettyPrint() const
 {
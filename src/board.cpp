@@ -21,10 +21,10 @@
 
 #include "chessgen/board.hpp"
 
+#include <algorithm>
 #include <cctype>
 #include <charconv>
 #include <iostream>
-#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string_view>
@@ -45,80 +45,192 @@ static constexpr std::string_view _initialFen[] = {
     // ThreeCheck
     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 +0+0",
 };
-static std::once_flag   _flag;
 
 // -------------------------------------------------------------------------------------------------
-Board::Board(ChessVariant variant)
+template <typename MoveCache>
+BasicBoard<MoveCache>::BasicBoard(ChessVariant variant, std::pmr::memory_resource* resource)
+    : mHistory{BoardState{}, GameHistory::DefaultCheckpointInterval, resource},
+      mUndone{resource},
+      mMoveCache{resource},
+      mFreeMoves{resource}
 {
-  std::call_once(_flag, [] { attacks::precomputeTables(); });
+  attacks::precomputeTables();
+  mFreeMoves.reserve(MoveCacheSize + 1);
   loadFen(_initialFen[int(variant)], variant);
 }
 // -------------------------------------------------------------------------------------------------
-Board::Board(std::string_view initialFen, ChessVariant variant)
+template <typename MoveCache>
+BasicBoard<MoveCache>::BasicBoard(std::string_view           initialFen,
+                                  ChessVariant               variant,
+                                  std::pmr::memory_resource* resource)
+    : mHistory{BoardState{}, GameHistory::DefaultCheckpointInterval, resource},
+      mUndone{resource},
+      mMoveCache{resource},
+      mFreeMoves{resource}
 {
-  std::call_once(_flag, [] { attacks::precomputeTables(); });
+  attacks::precomputeTables();
+  mFreeMoves.reserve(MoveCacheSize + 1);
   loadFen(initialFen, variant);
 }
 // -------------------------------------------------------------------------------------------------
-Board::Board(BoardState const& state)
-    : mStates{}, mReason{GameOverReason::OnGoing}, mLegalMoves{}, mBoardChanged{true}
+template <typename MoveCache>
+BasicBoard<MoveCache>::BasicBoard(BoardState const& state, std::pmr::memory_resource* resource)
+    : mHistory{state, GameHistory::DefaultCheckpointInterval, resource},
+      mUndone{resource},
+      mMoveCache{resource},
+      mFreeMoves{resource},
+      mReason{GameOverReason::OnGoing}
 {
-  mStates.push_back(GameState{state, std::nullopt});
+  mFreeMoves.reserve(MoveCacheSize + 1);
   gameOverCheck();
 }
 // -------------------------------------------------------------------------------------------------
-Board::Board(Board const& rhs)
-    : mStates{rhs.mStates}, mReason{rhs.mReason}, mLegalMoves{}, mBoardChanged{true}
+// The move cache of a copy starts empty, it refills as the copy is queried
+template <typename MoveCache>
+BasicBoard<MoveCache>::BasicBoard(BasicBoard const& rhs)
+    : mHistory{rhs.mHistory},
+      mUndone{rhs.mUndone, rhs.getMemoryResource()},
+      mMoveCache{rhs.getMemoryResource()},
+      mFreeMoves{rhs.getMemoryResource()},
+      mReason{rhs.mReason},
+      mVariant{rhs.mVariant}
 {
 }
 // -------------------------------------------------------------------------------------------------
-Board::Board(Board&& rhs) noexcept
-    : mStates{std::move(rhs.mStates)},
-      mReason{std::move(rhs.mReason)},
-      mLegalMoves{std::move(rhs.mLegalMoves)},
-      mBoardChanged{rhs.mBoardChanged.load()}
+template <typename MoveCache>
+BasicBoard<MoveCache>::BasicBoard(BasicBoard&& rhs) noexcept
+    : mHistory{std::move(rhs.mHistory)},
+      mUndone{std::move(rhs.mUndone)},
+      mMoveCache{std::move(rhs.mMoveCache)},
+      mFreeMoves{std::move(rhs.mFreeMoves)},
+      mReason{rhs.mReason},
+      mVariant{rhs.mVariant}
 {
+  mLegalMoves.store(rhs.mLegalMoves.take());
 }
 // -------------------------------------------------------------------------------------------------
-Board& Board::operator=(Board const& rhs)
+template <typename MoveCache>
+BasicBoard<MoveCache>& BasicBoard<MoveCache>::operator=(BasicBoard const& rhs)
 {
-  mStates       = rhs.mStates;
-  mReason       = rhs.mReason;
-  mLegalMoves   = rhs.mLegalMoves;
-  mBoardChanged = rhs.mBoardChanged.load();
+  mHistory = rhs.mHistory;
+  mUndone  = rhs.mUndone;
+  mReason  = rhs.mReason;
+  mVariant = rhs.mVariant;
+  clearMoveCache();
 
   return *this;
 }
 // -------------------------------------------------------------------------------------------------
-Board& Board::operator=(Board&& rhs) noexcept
+template <typename MoveCache>
+BasicBoard<MoveCache>& BasicBoard<MoveCache>::operator=(BasicBoard&& rhs) noexcept
 {
-  mStates       = std::move(rhs.mStates);
-  mReason       = std::move(rhs.mReason);
-  mLegalMoves   = std::move(rhs.mLegalMoves);
-  mBoardChanged = rhs.mBoardChanged.load();
+  mHistory   = std::move(rhs.mHistory);
+  mUndone    = std::move(rhs.mUndone);
+  mMoveCache = std::move(rhs.mMoveCache);
+  mFreeMoves = std::move(rhs.mFreeMoves);
+  mReason    = rhs.mReason;
+  mVariant   = rhs.mVariant;
+  mLegalMoves.store(rhs.mLegalMoves.take());
 
   return *this;
 }
 // -------------------------------------------------------------------------------------------------
-void Board::loadFen(std::string_view fen, ChessVariant variant)
+template <typename MoveCache>
+void BasicBoard<MoveCache>::loadFen(std::string_view fen, ChessVariant variant)
 {
-  {
-    auto lock = std::unique_lock(mMovesMutex);
-    mLegalMoves.clear();
+  clearMoveCache();
+  mUndone.clear();
+  mVariant = variant;
+  mReason  = GameOverReason::OnGoing;
+  mHistory = GameHistory{BoardState::fromFen(fen, variant), mHistory.getCheckpointInterval(),
+                         mHistory.getMemoryResource()};
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+void BasicBoard<MoveCache>::reset(BoardState const& state)
+{
+  clearMoveCache();
+  mUndone.clear();
+  if (mHistory.getCheckpointInterval() == GameHistory::DefaultCheckpointInterval) {
+    mHistory.reset(state);
+  } else {
+    mHistory = GameHistory{state, GameHistory::DefaultCheckpointInterval, getMemoryResource()};
+  }
+  mVariant = ChessVariant::Standard;
+  mReason  = GameOverReason::OnGoing;
+  gameOverCheck();
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+void BasicBoard<MoveCache>::clearMoveCache()
+{
+  for (auto& entry : mMoveCache) {
+    recycleMoves(std::move(entry.moves));
   }
-  mVariant      = variant;
-  mReason       = GameOverReason::OnGoing;
-  mBoardChanged = true;
-  mStates.clear();
-  mStates.push_back(GameState{BoardState::fromFen(fen, variant), std::nullopt});
+  mMoveCache.clear();
+  recycleMoves(mLegalMoves.take());
 }
 // -------------------------------------------------------------------------------------------------
-std::string Board::getFen() const
+// Keeps a list that is no longer needed for the next ply that needs one. There are never more
+// lists in use than the cache holds plus the current one, so neither are more kept
+template <typename MoveCache>
+void BasicBoard<MoveCache>::recycleMoves(MoveListPtr moves)
+{
+  if (moves && mFreeMoves.size() <= MoveCacheSize) {
+    moves->clear();
+    mFreeMoves.push_back(std::move(moves));
+  }
+}
+// -------------------------------------------------------------------------------------------------
+// Moves the legal moves of the current ply, if generated, into the per-ply cache. Called right
+// before leaving the ply
+template <typename MoveCache>
+void BasicBoard<MoveCache>::stashLegalMoves()
+{
+  auto moves = mLegalMoves.take();
+  if (!moves) {
+    return;
+  }
+
+  auto const ply = mHistory.size() - 1;
+  if (mMoveCache.size() < MoveCacheSize) {
+    mMoveCache.push_back(CachedMoves{ply, std::move(moves)});
+    return;
+  }
+
+  // Full, reuse the entry furthest away from where we are now
+  auto const distance = [ply](CachedMoves const& entry) {
+    return entry.ply > ply ? entry.ply - ply : ply - entry.ply;
+  };
+  auto const furthest =
+      std::max_element(mMoveCache.begin(), mMoveCache.end(), [&](auto const& a, auto const& b) {
+        return distance(a) < distance(b);
+      });
+  recycleMoves(std::move(furthest->moves));
+  *furthest = CachedMoves{ply, std::move(moves)};
+}
+// -------------------------------------------------------------------------------------------------
+// Publishes the cached legal moves of the ply we just arrived at, if any
+template <typename MoveCache>
+void BasicBoard<MoveCache>::restoreLegalMoves()
+{
+  auto const ply    = mHistory.size() - 1;
+  auto const cached = std::find_if(mMoveCache.begin(), mMoveCache.end(),
+                                   [ply](auto const& entry) { return entry.ply == ply; });
+  if (cached != mMoveCache.end()) {
+    mLegalMoves.store(std::move(cached->moves));
+    mMoveCache.erase(cached);
+  }
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+std::string BasicBoard<MoveCache>::getFen() const
 {
   return getState().getFen();
 }
 // -------------------------------------------------------------------------------------------------
-std::string Board::prettyPrint(bool useUnicodeChars) const
+template <typename MoveCache>
+std::string BasicBoard<MoveCache>::prettyPrint(bool useUnicodeChars) const
 {
   static std::string_view charPieces[2][6] = {
       {
@@ -183,31 +295,41 @@ std::string Board::prettyPrint(bool useUnicodeChars) const
   return ss.str();
 }
 // -------------------------------------------------------------------------------------------------
-std::vector<UCIMove> const& Board::getLegalMoves() const
+template <typename MoveCache>
+MoveList const& BasicBoard<MoveCache>::getLegalMoves() const
 {
-  if (mBoardChanged) {
-    auto lock = std::unique_lock{mMovesMutex};
-    if (mBoardChanged) {
-      mLegalMoves   = generateMoves<GenType::Legal>(getState());
-      mBoardChanged = false;
-    }
+  if (auto const moves = mLegalMoves.load()) {
+    return *moves;
   }
-
-  return mLegalMoves;
+  return mLegalMoves.publish(
+      makeMoveList(generateMoves<GenType::Legal>(getState(), getMemoryResource())));
 }
 // -------------------------------------------------------------------------------------------------
-std::vector<std::string> Board::getLegalMovesAsSAN() const
+template <typename MoveCache>
+PositionSnapshot BasicBoard<MoveCache>::createSnapshot() const
 {
+  return PositionSnapshot{mHistory, getLegalMoves(), mReason};
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+std::vector<std::string> BasicBoard<MoveCache>::getLegalMovesAsSAN() const
+{
+  auto const& moves = getLegalMoves();
+  auto        san   = std::vector<SanText>(moves.size());
+  getState().getSanForMoves(moves, san.data());
+
   auto result = std::vector<std::string>{};
-  for (auto&& move : getLegalMoves()) {
-    result.emplace_back(getSanForMove(move));
+  result.reserve(san.size());
+  for (auto const& text : san) {
+    result.emplace_back(text.view());
   }
   return result;
 }
 // -------------------------------------------------------------------------------------------------
-std::vector<UCIMove> Board::getLegalMovesForSquare(Square square) const
+template <typename MoveCache>
+MoveList BasicBoard<MoveCache>::getLegalMovesForSquare(Square square) const
 {
-  auto       result = std::vector<UCIMove>{};
+  auto       result = MoveList{getMemoryResource()};
   auto const ksq    = getState().getKingSquare(getActivePlayer());
 
   for (auto&& move : getLegalMoves()) {
@@ -220,12 +342,15 @@ std::vector<UCIMove> Board::getLegalMovesForSquare(Square square) const
   return result;
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isValid(std::string_view move) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isValid(std::string_view move) const
 {
-  return isValid(SANMove::parse(move));
+  auto san = SANMove{};
+  return SANMove::tryParse(move, san) == SanError::None && isValid(san);
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isValid(Square from, Square to) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isValid(Square from, Square to) const
 {
   auto& state = getState();
 
@@ -245,41 +370,23 @@ bool Board::isValid(Square from, Square to) const
   return isValid(UCIMove{from, to});
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isValid(CastleSide castle) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isValid(CastleSide castle) const
 {
   auto& state = getState();
   return castle == CastleSide::King ? state.canShortCastle(getActivePlayer())
                                     : state.canLongCastle(getActivePlayer());
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isValid(SANMove const& move) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isValid(SANMove const& move) const
 {
-  if (move.isCastling()) {
-    return isValid(move.getCastleSide());
-  }
-
-  auto& state = getState();
-
-  for (auto&& m : getLegalMoves()) {
-    if (state.getPieceOn(m.fromSquare()).type != move.piece()) {
-      continue;
-    }
-
-    if (m.toSquare() == move.toSquare()) {
-      if (move.fromFile() == File::None || move.fromFile() == getFile(m.fromSquare())) {
-        if (move.fromRank() == Rank::None || move.fromRank() == getRank(m.fromSquare())) {
-          if (move.isPromotion() == m.isPromotion()) {
-            return true;
-          }
-        }
-      }
-    }
-  }
-
-  return false;
+  auto uci = UCIMove{};
+  return resolveSan(move, uci);
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isValid(UCIMove const& move) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isValid(UCIMove const& move) const
 {
   if (move.isCastling()) {
     return isValid(move.getCastleSide());
@@ -293,102 +400,148 @@ bool Board::isValid(UCIMove const& move) const
   return false;
 }
 // -------------------------------------------------------------------------------------------------
-ChessVariant Board::getVariant() const
+template <typename MoveCache>
+ChessVariant BasicBoard<MoveCache>::getVariant() const
 {
   return mVariant;
 }
 // -------------------------------------------------------------------------------------------------
-UCIMove Board::sanToUci(std::string_view move) const
+template <typename MoveCache>
+UCIMove BasicBoard<MoveCache>::sanToUci(std::string_view move) const
 {
-  auto const san = SANMove::parse(move);
-
-  if (san.isCastling()) {
-    return UCIMove{san.getCastleSide()};
+  auto uci = UCIMove{};
+  if (!resolveSan(SANMove::parse(move), uci)) {
+    throw std::runtime_error("Invalid move");
   }
-
-  auto& state = getState();
-
-  for (auto&& m : getLegalMoves()) {
-    if (state.getPieceOn(m.fromSquare()).type != san.piece()) {
-      continue;
-    }
-
-    if (m.toSquare() == san.toSquare()) {
-      if (san.fromFile() == File::None || san.fromFile() == getFile(m.fromSquare())) {
-        if (san.fromRank() == Rank::None || san.fromRank() == getRank(m.fromSquare())) {
-          if (san.isPromotion() == m.isPromotion()) {
-            return m;
-          }
-        }
-      }
-    }
+  return uci;
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+std::optional<UCIMove> BasicBoard<MoveCache>::trySanToUci(std::string_view move) const
+{
+  auto san = SANMove{};
+  auto uci = UCIMove{};
+  if (SANMove::tryParse(move, san) != SanError::None || !resolveSan(san, uci)) {
+    return std::nullopt;
   }
-
-  throw std::runtime_error("Invalid move");
+  return uci;
 }
 // -------------------------------------------------------------------------------------------------
-std::string Board::getSanForMove(UCIMove const& move) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::resolveSan(SANMove const& move, UCIMove& out) const
+{
+  return getState().resolveSan(move, out);
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+std::string BasicBoard<MoveCache>::getSanForMove(UCIMove const& move) const
 {
   return getState().getSanForMove(move);
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::makeMove(CastleSide side)
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::makeMove(CastleSide side)
 {
   return makeMove(UCIMove{side});
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::makeMove(SANMove const& move)
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::makeMove(SANMove const& move)
 {
-  if (move.isCastling()) {
-    return makeMove(move.getCastleSide());
+  // A resolved move is legal, there is no need to look for it in the legal moves again
+  auto uci = UCIMove{};
+  if (!resolveSan(move, uci)) {
+    return false;
   }
 
-  auto& state = getState();
-  for (auto&& m : getLegalMoves()) {
-    if (state.getPieceOn(m.fromSquare()).type != move.piece()) {
-      continue;
-    }
+  playMove(uci);
+  return true;
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::makeMove(UCIMove const& move)
+{
+  if (!isValid(move)) {
+    return false;
+  }
 
-    if (m.toSquare() == move.toSquare()) {
-      if (move.fromFile() == File::None || move.fromFile() == getFile(m.fromSquare())) {
-        if (move.fromRank() == Rank::None || move.fromRank() == getRank(m.fromSquare())) {
-          if (move.isPromotion() == m.isPromotion()) {
-            return makeMove(m);
-          }
-        }
-      }
+  playMove(move);
+  return true;
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+void BasicBoard<MoveCache>::playMove(UCIMove const& move)
+{
+  auto const ply = mHistory.size() - 1;
+
+  if (!mUndone.empty() && mUndone.back().move == move) {
+    // Replaying the move that was just taken back: the position and the cached moves of the
+    // plies after this one are still valid
+    auto redo = std::move(mUndone.back());
+    mUndone.pop_back();
+
+    stashLegalMoves();
+    mHistory.push(redo.move, redo.state);
+  } else {
+    auto state = getState();
+
+    // Kept out of the assert, which compiles to nothing in release builds
+    [[maybe_unused]] auto const applied = state.makeMove(move);
+    CHESSGEN_ASSERT(applied);
+
+    mUndone.clear();
+    auto const stale = std::partition(mMoveCache.begin(), mMoveCache.end(),
+                                      [ply](auto const& entry) { return entry.ply <= ply; });
+    for (auto it = stale; it != mMoveCache.end(); ++it) {
+      recycleMoves(std::move(it->moves));
     }
+    mMoveCache.erase(stale, mMoveCache.end());
+
+    stashLegalMoves();
+    mHistory.push(move, state);
   }
 
-  return false;
+  restoreLegalMoves();
+  gameOverCheck();
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::makeMove(UCIMove const& move)
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::undoMove()
 {
-  if (!isValid(move)) {
+  if (mHistory.size() == 1) {
     return false;
   }
 
-  mStates.back().movePlayed = move;
+  mUndone.push_back(UndoneMove{mHistory.getMove(mHistory.size() - 2), mHistory.back()});
+  stashLegalMoves();
+  mHistory.pop();
+  restoreLegalMoves();
 
-  auto state = getState();
-  
-  CHESSGEN_ASSERT(state.makeMove(move));
-
-  mStates.emplace_back(std::move(state), std::nullopt);
-
-  mBoardChanged = true;
+  mReason = GameOverReason::OnGoing;
   gameOverCheck();
 
   return true;
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::makeMove(std::string_view move)
+template <typename MoveCache>
+std::size_t BasicBoard<MoveCache>::undoMoves(std::size_t count)
 {
-  return makeMove(SANMove::parse(move));
+  auto undone = std::size_t{0};
+  while (undone < count && undoMove()) {
+    ++undone;
+  }
+  return undone;
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::makeMove(Square from, Square to)
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::makeMove(std::string_view move)
+{
+  auto san = SANMove{};
+  return SANMove::tryParse(move, san) == SanError::None && makeMove(san);
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::makeMove(Square from, Square to)
 {
   if (!isValid(from, to)) {
     return false;
@@ -407,51 +560,50 @@ bool Board::makeMove(Square from, Square to)
   return makeMove(UCIMove{from, to});
 }
 // -------------------------------------------------------------------------------------------------
-int Board::getHalfMoves() const
+template <typename MoveCache>
+int BasicBoard<MoveCache>::getHalfMoves() const
 {
   return getState().getHalfMoves();
 }
 // -------------------------------------------------------------------------------------------------
-int Board::getFullMove() const
+template <typename MoveCache>
+int BasicBoard<MoveCache>::getFullMove() const
 {
   return getState().getFullMove();
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isInitialPosition() const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isInitialPosition() const
 {
   return getFen() == _initialFen[int(getVariant())];
 }
 // -------------------------------------------------------------------------------------------------
-Color Board::getActivePlayer() const
+template <typename MoveCache>
+Color BasicBoard<MoveCache>::getActivePlayer() const
 {
   return getState().getActivePlayer();
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isOver() const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isOver() const
 {
   return getGameOverReason() != GameOverReason::OnGoing;
 }
 // -------------------------------------------------------------------------------------------------
-GameOverReason Board::getGameOverReason() const
+template <typename MoveCache>
+GameOverReason BasicBoard<MoveCache>::getGameOverReason() const
 {
   return mReason;
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isInCheck() const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isInCheck() const
 {
-  auto& state = getState();
-
-  auto const kingSquareIndex = state.getKingSquare(getActivePlayer());
-
-  // no king?
-  if (kingSquareIndex == Square::None) {
-    return false;
-  }
-
-  return state.isSquareUnderAttack(~getActivePlayer(), kingSquareIndex);
+  return getState().isInCheck();
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isInsufficientMaterial() const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isInsufficientMaterial() const
 {
   auto const toMove = getActivePlayer();
   auto&      state  = getState();
@@ -469,24 +621,44 @@ bool Board::isInsufficientMaterial() const
   return false;
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isThreefold() const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isThreefold() const
 {
   // TODO: Support 3-fold repetition
   return false;
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isStalemate() const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isStalemate() const
 {
   return !isInCheck() && getLegalMoves().size() == 0;
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isCheckmate() const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isCheckmate() const
 {
   return isInCheck() && getLegalMoves().size() == 0;
 }
 // -------------------------------------------------------------------------------------------------
-void Board::gameOverCheck()
-{
+template <typename MoveCache>
+void BasicBoard<MoveCache>::gameOverCheck()
+{
+  // Every modification ends up here and needs the legal moves, so generate them now, into a
+  // recycled list if there is one. Lists made here have room for any position, so once a board
+  // has played a game it never allocates for moves again
+  if (!mLegalMoves.load()) {
+    auto moves = MoveListPtr{};
+    if (mFreeMoves.empty()) {
+      moves = makeMoveList(MoveList{getMemoryResource()});
+      moves->reserve(MaxLegalMoves);
+    } else {
+      moves = std::move(mFreeMoves.back());
+      mFreeMoves.pop_back();
+    }
+    generateMoves<GenType::Legal>(getState(), *moves);
+    mLegalMoves.store(std::move(moves));
+  }
+
   if (getLegalMoves().size() == 0) {
     mReason = isInCheck() ? GameOverReason::Mate : GameOverReason::Stalemate;
   } else if (isInsufficientMaterial()) {
@@ -496,69 +668,131 @@ void Board::gameOverCheck()
   }
 }
 // -------------------------------------------------------------------------------------------------
-BoardState const& Board::getState() const
+template <typename MoveCache>
+BoardState const& BasicBoard<MoveCache>::getState() const
+{
+  return mHistory.back();
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+std::vector<typename BasicBoard<MoveCache>::GameState> BasicBoard<MoveCache>::getGameHistory() const
+{
+  auto result = std::vector<GameState>{};
+  result.reserve(mHistory.size());
+
+  // Walk forward from the initial position instead of rebuilding every ply on its own
+  auto state = mHistory.getState(0);
+  for (auto const& move : mHistory.getMoves()) {
+    result.emplace_back(state, move);
+    state.makeMove(move);
+  }
+  result.emplace_back(mHistory.back(), std::nullopt);
+
+  return result;
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+GameHistory const& BasicBoard<MoveCache>::getHistory() const
+{
+  return mHistory;
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+std::size_t BasicBoard<MoveCache>::getHistorySize() const
+{
+  return mHistory.size();
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+BoardState BasicBoard<MoveCache>::getStateAt(std::size_t ply) const
+{
+  return mHistory.getState(ply);
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+UCIMove BasicBoard<MoveCache>::getMoveAt(std::size_t ply) const
+{
+  return mHistory.getMove(ply);
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+void BasicBoard<MoveCache>::setHistoryCheckpointInterval(int plies)
 {
-  return mStates.back().boardState;
+  mHistory.setCheckpointInterval(plies);
 }
 // -------------------------------------------------------------------------------------------------
-std::vector<Board::GameState> const& Board::getGameHistory() const
+template <typename MoveCache>
+std::pmr::memory_resource* BasicBoard<MoveCache>::getMemoryResource() const
 {
-  return mStates;
+  return mHistory.getMemoryResource();
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::canShortCastle(Color color) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::canShortCastle(Color color) const
 {
   return getState().canShortCastle(color);
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::canLongCastle(Color color) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::canLongCastle(Color color) const
 {
   return getState().canLongCastle(color);
 }
 // -------------------------------------------------------------------------------------------------
-Bitboard Board::getPieces(Piece type) const
+template <typename MoveCache>
+Bitboard BasicBoard<MoveCache>::getPieces(Piece type) const
 {
   return getState().getPieces(type);
 }
 // -------------------------------------------------------------------------------------------------
-Bitboard Board::getPieces(Color color, Piece type) const
+template <typename MoveCache>
+Bitboard BasicBoard<MoveCache>::getPieces(Color color, Piece type) const
 {
   return getState().getPieces(color, type);
 }
 // -------------------------------------------------------------------------------------------------
-PieceInfo Board::getPieceOn(Square sq) const
+template <typename MoveCache>
+PieceInfo BasicBoard<MoveCache>::getPieceOn(Square sq) const
 {
   return getState().getPieceOn(sq);
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isSquareEmpty(Square sq) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isSquareEmpty(Square sq) const
 {
   return getState().isSquareEmpty(sq);
 }
 // -------------------------------------------------------------------------------------------------
-Bitboard Board::getCheckSquares(Color color, Piece piece) const
+template <typename MoveCache>
+Bitboard BasicBoard<MoveCache>::getCheckSquares(Color color, Piece piece) const
 {
   return getState().getCheckSquares(color, piece);
 }
 // -------------------------------------------------------------------------------------------------
-Bitboard Board::getCheckers() const
+template <typename MoveCache>
+Bitboard BasicBoard<MoveCache>::getCheckers() const
 {
   return getState().getCheckers();
 }
 // -------------------------------------------------------------------------------------------------
-Square Board::getKingSquare(Color color) const
+template <typename MoveCache>
+Square BasicBoard<MoveCache>::getKingSquare(Color color) const
 {
   return getState().getKingSquare(color);
 }
 // -------------------------------------------------------------------------------------------------
-Square Board::getEnPassantSquare() const
+template <typename MoveCache>
+Square BasicBoard<MoveCache>::getEnPassantSquare() const
 {
   return getState().getEnPassantSquare();
 }
 // -------------------------------------------------------------------------------------------------
-bool Board::isSquareUnderAttack(Color enemy, Square square) const
+template <typename MoveCache>
+bool BasicBoard<MoveCache>::isSquareUnderAttack(Color enemy, Square square) const
 {
   return getState().isSquareUnderAttack(enemy, square);
 }
 // -------------------------------------------------------------------------------------------------
+template class BasicBoard<LockFreeMoveCache>;
+template class BasicBoard<UnsynchronizedMoveCache>;
 }  // namespace chessgen
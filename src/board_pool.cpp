@@ -0,0 +1,89 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "chessgen/board_pool.hpp"
+
+namespace chessgen
+{
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+void BasicBoardPool<MoveCache>::Releaser::operator()(BoardType* board) const
+{
+  pool->release(board);
+}
+// -------------------------------------------------------------------------------------------------
+// The initial position is parsed once, here, and reset() copies it from then on
+template <typename MoveCache>
+BasicBoardPool<MoveCache>::BasicBoardPool(std::size_t maxIdle)
+    : mInitial{BoardType{}.getState()}, mMaxIdle{maxIdle}
+{
+  mIdle.reserve(maxIdle);
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+typename BasicBoardPool<MoveCache>::Handle BasicBoardPool<MoveCache>::acquire()
+{
+  return acquire(mInitial);
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+typename BasicBoardPool<MoveCache>::Handle BasicBoardPool<MoveCache>::acquire(
+    BoardState const& state)
+{
+  auto board = std::unique_ptr<BoardType>{};
+  {
+    auto const lock = std::lock_guard<std::mutex>{mMutex};
+    if (!mIdle.empty()) {
+      board = std::move(mIdle.back());
+      mIdle.pop_back();
+    }
+  }
+
+  if (board) {
+    board->reset(state);
+  } else {
+    board = std::make_unique<BoardType>(state);
+  }
+  return Handle{board.release(), Releaser{this}};
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+std::size_t BasicBoardPool<MoveCache>::getIdleCount() const
+{
+  auto const lock = std::lock_guard<std::mutex>{mMutex};
+  return mIdle.size();
+}
+// -------------------------------------------------------------------------------------------------
+template <typename MoveCache>
+void BasicBoardPool<MoveCache>::release(BoardType* board)
+{
+  auto owned = std::unique_ptr<BoardType>{board};
+
+  auto const lock = std::lock_guard<std::mutex>{mMutex};
+  if (mIdle.size() < mMaxIdle) {
+    mIdle.push_back(std::move(owned));
+  }
+}
+// -------------------------------------------------------------------------------------------------
+template class BasicBoardPool<LockFreeMoveCache>;
+template class BasicBoardPool<UnsynchronizedMoveCache>;
+}  // namespace chessgen
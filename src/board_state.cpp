@@ -21,12 +21,15 @@
 
 #include "chessgen/board_state.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <charconv>
+#include <cstring>
 
 #include "chessgen/attacks.hpp"
 #include "chessgen/board.hpp"
 #include "chessgen/helpers.hpp"
+#include "chessgen/movegen.hpp"
 
 namespace chessgen
 {
@@ -36,12 +39,44 @@ static int notationToIndex(std::string_view notation)
   return static_cast<int>(makeSquare(File(notation[0] - 'a'), Rank(notation[1] - '1')));
 }
 // -------------------------------------------------------------------------------------------------
-static std::string indexToNotation(int index)
+// Random keys for the position hash: one per piece on each square, per combination of castling
+// rights and per en passant file, plus one for black to move. Made at compile time by splitmix64
+struct ZobristKeys {
+  std::uint64_t pieces[ColorCount][PieceCount][64];
+  std::uint64_t castling[16];
+  std::uint64_t enPassant[8];
+  std::uint64_t blackToMove;
+};
+
+static constexpr ZobristKeys makeZobristKeys()
 {
-  using std::to_string;
+  auto keys = ZobristKeys{};
+  auto seed = std::uint64_t{0};
+  auto next = [&seed] {
+    auto z = seed += 0x9E3779B97F4A7C15ULL;
+    z      = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z      = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  };
 
-  return to_string(Square(index));
+  for (auto& color : keys.pieces) {
+    for (auto& piece : color) {
+      for (auto& key : piece) {
+        key = next();
+      }
+    }
+  }
+  for (auto& key : keys.castling) {
+    key = next();
+  }
+  for (auto& key : keys.enPassant) {
+    key = next();
+  }
+  keys.blackToMove = next();
+  return keys;
 }
+
+static constexpr auto _zobrist = makeZobristKeys();
 // -------------------------------------------------------------------------------------------------
 void BoardState::clearEnPassant()
 {
@@ -61,310 +96,443 @@ void BoardState::updateNonPieceBitboards()
   mOccupied = mAllPieces[ColorWhite] | mAllPieces[ColorBlack];
 }
 // -------------------------------------------------------------------------------------------------
-std::string BoardState::getFen() const
+void BoardState::updateAttackMaps()
 {
-  std::string fen;
+  for (auto color : {ColorWhite, ColorBlack}) {
+    // The enemy king is taken out of the occupancy so that sliders keep attacking the squares
+    // behind it. Otherwise the king could "escape" a check by stepping back along the ray.
+    auto const occupied = mOccupied & ~mPieces[~color][PieceKing];
 
-  int emptyCount = 0;
+    auto const rooksOrQueens   = mPieces[color][PieceRook] | mPieces[color][PieceQueen];
+    auto const bishopsOrQueens = mPieces[color][PieceBishop] | mPieces[color][PieceQueen];
 
-  for (auto i = 56; i >= 0; i -= 8) {
-    for (int boardPos = i; boardPos < i + 8; boardPos++) {
-      auto const square         = makeSquare(boardPos);
-      auto const squareOccupied = !!(mOccupied & square);
-      if (squareOccupied) {
-        auto [piece, color] = getPieceOn(square);
-        if (emptyCount > 0) {
-          fen += std::to_string(emptyCount);
-          emptyCount = 0;
-        }
-        if (color == ColorWhite)
-          fen += to_string<ColorWhite>(piece);
-        else
-          fen += to_string<ColorBlack>(piece);
-      } else {
-        emptyCount++;
+    mAttacked[color] = attacks::getPawnAttacks(color, mPieces[color][PiecePawn]) |
+                       attacks::getKnightAttacks(mPieces[color][PieceKnight]) |
+                       attacks::getKingAttacks(mPieces[color][PieceKing]) |
+                       attacks::getSliderAttacks(rooksOrQueens, bishopsOrQueens, occupied);
+  }
+}
+// -------------------------------------------------------------------------------------------------
+std::string BoardState::getFen() const
+{
+  char buffer[FenBufferSize];
+  return std::string(buffer, writeFen(buffer, sizeof(buffer)));
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t BoardState::writeFen(char* out, std::size_t capacity) const
+{
+  static constexpr char pieceChars[ColorCount][PieceCount] = {
+      {'P', 'B', 'N', 'R', 'Q', 'K'},
+      {'p', 'b', 'n', 'r', 'q', 'k'},
+  };
+  static_assert(PiecePawn == 0 && PieceBishop == 1 && PieceKnight == 2 && PieceRook == 3 &&
+                PieceQueen == 4 && PieceKing == 5);
+
+  // Spread the piece bitboards over a mailbox first, then emit it rank by rank
+  char board[64] = {};
+  for (auto color : {ColorWhite, ColorBlack}) {
+    for (auto piece = 0; piece < PieceCount; ++piece) {
+      for (auto b = mPieces[color][piece]; b;) {
+        board[b.popLsb()] = pieceChars[color][piece];
       }
     }
-    if (emptyCount > 0) {
-      fen += std::to_string(emptyCount);
-      emptyCount = 0;
+  }
+
+  char  buffer[FenBufferSize];
+  char* p = buffer;
+  for (auto rank = 7; rank >= 0; --rank) {
+    auto empty = 0;
+    for (auto square = rank * 8; square < rank * 8 + 8; ++square) {
+      if (!board[square]) {
+        ++empty;
+        continue;
+      }
+      if (empty) {
+        *p++  = static_cast<char>('0' + empty);
+        empty = 0;
+      }
+      *p++ = board[square];
     }
-    if (i != 0) fen += '/';
+    if (empty) *p++ = static_cast<char>('0' + empty);
+    if (rank) *p++ = '/';
   }
 
-  fen += mTurn == ColorWhite ? " w " : " b ";
+  *p++ = ' ';
+  *p++ = mTurn == ColorWhite ? 'w' : 'b';
+  *p++ = ' ';
   if (mCastleRights[ColorWhite] == CastleSide::None && mCastleRights[ColorBlack] == CastleSide::None) {
-    fen += '-';
+    *p++ = '-';
+  } else {
+    if (enumHasFlag(mCastleRights[ColorWhite], CastleSide::King)) *p++ = 'K';
+    if (enumHasFlag(mCastleRights[ColorWhite], CastleSide::Queen)) *p++ = 'Q';
+    if (enumHasFlag(mCastleRights[ColorBlack], CastleSide::King)) *p++ = 'k';
+    if (enumHasFlag(mCastleRights[ColorBlack], CastleSide::Queen)) *p++ = 'q';
+  }
+
+  *p++ = ' ';
+  if (!mEnPassant) {
+    *p++ = '-';
   } else {
-    if (enumHasFlag(mCastleRights[ColorWhite], CastleSide::King)) fen += 'K';
-    if (enumHasFlag(mCastleRights[ColorWhite], CastleSide::Queen)) fen += 'Q';
-    if (enumHasFlag(mCastleRights[ColorBlack], CastleSide::King)) fen += 'k';
-    if (enumHasFlag(mCastleRights[ColorBlack], CastleSide::Queen)) fen += 'q';
+    auto const ep = mEnPassant.lsb();
+    *p++          = static_cast<char>('a' + ep % 8);
+    *p++          = static_cast<char>('1' + ep / 8);
   }
 
-  fen += ' ';
-  fen += !mEnPassant ? "-" : indexToNotation(mEnPassant.lsb());
-  fen += " " + std::to_string(mHalfMoves);
-  fen += " " + std::to_string(mFullMove);
+  auto const end = buffer + sizeof(buffer) - 1;
+  *p++           = ' ';
+  p              = std::to_chars(p, end, mHalfMoves).ptr;
+  *p++           = ' ';
+  p              = std::to_chars(p, end, mFullMove).ptr;
 
-  return fen;
+  auto const length = static_cast<std::size_t>(p - buffer);
+  if (length + 1 > capacity) {
+    return 0;
+  }
+  std::memcpy(out, buffer, length);
+  out[length] = '\0';
+  return length;
 }
 // -------------------------------------------------------------------------------------------------
 BoardState BoardState::fromFen(std::string_view view, ChessVariant variant)
 {
-  auto const fields = stringSplit(view, ' ');
-
-  auto parsePiecePlacement = [&](BoardState& state, std::string_view str) {
-    auto boardPos = 56ULL;
-
-    auto getPieceInfo = [](char c) -> std::pair<Color, Piece> {
-      switch (c) {
-        case 'p':
-          return std::make_pair(ColorBlack, PiecePawn);
-        case 'r':
-          return std::make_pair(ColorBlack, PieceRook);
-        case 'n':
-          return std::make_pair(ColorBlack, PieceKnight);
-        case 'b':
-          return std::make_pair(ColorBlack, PieceBishop);
-        case 'q':
-          return std::make_pair(ColorBlack, PieceQueen);
-        case 'k':
-          return std::make_pair(ColorBlack, PieceKing);
-        case 'P':
-          return std::make_pair(ColorWhite, PiecePawn);
-        case 'R':
-          return std::make_pair(ColorWhite, PieceRook);
-        case 'N':
-          return std::make_pair(ColorWhite, PieceKnight);
-        case 'B':
-          return std::make_pair(ColorWhite, PieceBishop);
-        case 'Q':
-          return std::make_pair(ColorWhite, PieceQueen);
-        case 'K':
-          return std::make_pair(ColorWhite, PieceKing);
-        default:
-          assert(!"Logic error");
-          return {};
-      }
-    };
+  auto state = BoardState{};
+  auto error = parseFen(view, state, variant);
+  if (error != FenError::None) {
+    throw std::runtime_error{to_string(error)};
+  }
+  return state;
+}
+// -------------------------------------------------------------------------------------------------
+// Returns the next space separated field and advances past it. Empty once the input runs out
+static std::string_view nextFenField(std::string_view& rest)
+{
+  auto const begin = rest.find_first_not_of(' ');
+  if (begin == std::string_view::npos) {
+    rest = {};
+    return {};
+  }
 
-    for (auto&& currChar : str) {
-      if ((currChar != '/' && boardPos >= 64) || boardPos > 64) {
-        throw std::runtime_error{"Malformed FEN string"};
-      }
+  auto const end   = std::min(rest.find(' ', begin), rest.size());
+  auto const field = rest.substr(begin, end - begin);
+  rest.remove_prefix(end);
+  return field;
+}
+// -------------------------------------------------------------------------------------------------
+static bool parseFenNumber(std::string_view field, int& out)
+{
+  auto const last = field.data() + field.size();
+  auto [ptr, ec]  = std::from_chars(field.data(), last, out);
+  return ec == std::errc() && ptr == last && out >= 0;
+}
+// -------------------------------------------------------------------------------------------------
+FenError BoardState::parseFen(std::string_view fen, BoardState& out, ChessVariant variant) noexcept
+{
+  if (variant != ChessVariant::Standard) {
+    return FenError::UnsupportedVariant;
+  }
 
-      switch (currChar) {
-        case 'p':
-        case 'r':
-        case 'n':
-        case 'b':
-        case 'q':
-        case 'k':
-        case 'P':
-        case 'R':
-        case 'N':
-        case 'B':
-        case 'Q':
-        case 'K': {
-          auto [color, piece] = getPieceInfo(currChar);
-
-          state.mPieces[color][piece].setBit(boardPos++);
-          break;
+  auto state = BoardState{};
+  auto rest  = fen;
+
+  // Piece placement, from a8 to h1
+  auto rank = 7;
+  auto file = 0;
+  for (auto c : nextFenField(rest)) {
+    if (c == '/') {
+      if (file != 8 || rank == 0) return FenError::PiecePlacement;
+      --rank;
+      file = 0;
+    } else if (c >= '1' && c <= '8') {
+      file += c - '0';
+      if (file > 8) return FenError::PiecePlacement;
+    } else {
+      auto const color = c >= 'a' ? ColorBlack : ColorWhite;
+      auto const piece = [lower = c | 0x20] {
+        // clang-format off
+        switch (lower) {
+          case 'p': return PiecePawn;   case 'n': return PieceKnight;
+          case 'b': return PieceBishop; case 'r': return PieceRook;
+          case 'q': return PieceQueen;  case 'k': return PieceKing;
+          default:  return PieceNone;
         }
-        case '/':
-          boardPos -= 16;  // Go down one rank
-          break;
-          // clang-format off
-      case '1': case '2': case '3': 
-      case '4': case '5': case '6':  
-      case '7': case '8': case '9': 
-        boardPos += static_cast<std::uint64_t>(currChar) - '0';
-        break;
         // clang-format on
-        default:
-          throw std::runtime_error{"Malformed FEN string"};
-      }
+      }();
+      if (piece == PieceNone || file == 8) return FenError::PiecePlacement;
+      state.mPieces[color][piece].setBit(static_cast<std::uint64_t>(rank * 8 + file++));
     }
+  }
+  if (rank != 0 || file != 8) {
+    return FenError::PiecePlacement;
+  }
+
+  // Active color
+  auto const turn = nextFenField(rest);
+  if (turn == "w")
+    state.mTurn = ColorWhite;
+  else if (turn == "b")
+    state.mTurn = ColorBlack;
+  else
+    return FenError::ActiveColor;
 
-    if (boardPos != 8) {
-      throw std::runtime_error{"Malformed FEN string"};
+  // Castling rights
+  auto const castling = nextFenField(rest);
+  if (castling.empty()) {
+    return FenError::Castling;
+  }
+  if (castling != "-") {
+    for (auto c : castling) {
+      auto const color = c >= 'a' ? ColorBlack : ColorWhite;
+      auto const side  = (c | 0x20) == 'k' ? CastleSide::King
+                         : (c | 0x20) == 'q' ? CastleSide::Queen
+                                             : CastleSide::None;
+      if (side == CastleSide::None) return FenError::Castling;
+      state.mCastleRights[color] = state.mCastleRights[color] | side;
     }
-  };
+  }
 
-  auto parsePlayerTurn = [&](BoardState& state, std::string_view str) {
-    if (str == "w")
-      state.mTurn = ColorWhite;
-    else if (str == "b")
-      state.mTurn = ColorBlack;
-    else
-      throw std::runtime_error{"Invalid play turn"};
-  };
+  // En passant square
+  auto const enPassant = nextFenField(rest);
+  if (enPassant != "-") {
+    if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' || enPassant[1] < '1' ||
+        enPassant[1] > '8')
+      return FenError::EnPassant;
 
-  auto parseCastlingAvailability = [&](BoardState& state, std::string_view str) {
-    if (str != "-") {
-      for (auto&& c : str) {
-        if (c == 'K') {
-          state.mCastleRights[ColorWhite] = state.mCastleRights[ColorWhite] | CastleSide::King;
-        } else if (c == 'Q') {
-          state.mCastleRights[ColorWhite] = state.mCastleRights[ColorWhite] | CastleSide::Queen;
-        } else if (c == 'k') {
-          state.mCastleRights[ColorBlack] = state.mCastleRights[ColorBlack] | CastleSide::King;
-        } else if (c == 'q') {
-          state.mCastleRights[ColorBlack] = state.mCastleRights[ColorBlack] | CastleSide::Queen;
-        } else {
-          throw std::runtime_error{"Invalid castling rights"};
-        }
-      }
-    }
-  };
+    state.mEnPassant.setBit(notationToIndex(enPassant));
+  }
+
+  // Move counters, both or neither
+  auto const halfMoves = nextFenField(rest);
+  auto const fullMove  = nextFenField(rest);
+  if (!halfMoves.empty()) {
+    if (fullMove.empty()) return FenError::FieldCount;
+    if (!parseFenNumber(halfMoves, state.mHalfMoves)) return FenError::HalfMoves;
+    if (!parseFenNumber(fullMove, state.mFullMove)) return FenError::FullMove;
+  }
+  if (!nextFenField(rest).empty()) {
+    return FenError::FieldCount;
+  }
 
-  auto parseEnPassantSquare = [&](BoardState& state, std::string_view str) {
-    if (str != "-") {
-      if (str[0] < 'a' || str[0] > 'h' || str[1] < '1' || str[1] > '8')
-        throw std::runtime_error{"Invalid EP square"};
+  state.updateNonPieceBitboards();
+  state.updateAttackMaps();
 
-      state.mEnPassant.setBit(notationToIndex(str));
+  out = state;
+  return FenError::None;
+}
+// -------------------------------------------------------------------------------------------------
+char const* to_string(FenError error)
+{
+  switch (error) {
+    case FenError::None:
+      return "No error";
+    case FenError::PiecePlacement:
+      return "Malformed FEN string";
+    case FenError::ActiveColor:
+      return "Invalid play turn";
+    case FenError::Castling:
+      return "Invalid castling rights";
+    case FenError::EnPassant:
+      return "Invalid EP square";
+    case FenError::HalfMoves:
+      return "Invalid half move value";
+    case FenError::FullMove:
+      return "Invalid full move value";
+    case FenError::FieldCount:
+      return "Malformed FEN string";
+    case FenError::UnsupportedVariant:
+      return "Unsupported chess variant";
+  }
+  return "Unknown error";
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t writeFens(BoardState const* states,
+                      std::size_t       count,
+                      char*             out,
+                      std::size_t       capacity,
+                      std::size_t*      written)
+{
+  auto used = std::size_t{0};
+  auto i    = std::size_t{0};
+  for (; i < count; ++i) {
+    // writeFen wants room for its NUL, which the newline then overwrites
+    auto const length = states[i].writeFen(out + used, capacity - used);
+    if (length == 0) {
+      break;
     }
-  };
+    out[used + length] = '\n';
+    used += length + 1;
+  }
 
-  auto parseHalfMoveNumber = [&](BoardState& state, std::string_view str) {
-    auto [p, ec] = std::from_chars(str.data(), str.data() + str.size(), state.mHalfMoves);
-    if (ec != std::errc()) {
-      throw std::runtime_error{"Invalid half move value"};
+  if (written) {
+    *written = i;
+  }
+  return used;
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t parseFens(std::string_view const* fens,
+                      BoardState*             states,
+                      FenError*               errors,
+                      std::size_t             count,
+                      ChessVariant            variant)
+{
+  auto parsed = std::size_t{0};
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    auto const error = BoardState::parseFen(fens[i], states[i], variant);
+    if (errors) {
+      errors[i] = error;
     }
-  };
+    parsed += error == FenError::None;
+  }
+  return parsed;
+}
+// -------------------------------------------------------------------------------------------------
+std::string BoardState::getSanForMove(UCIMove const& move) const
+{
+  auto const piece = move.isCastling() ? PieceKing : getPieceOn(move.fromSquare()).type;
+  if (piece == PieceNone) return "";
 
-  auto parseFullMoveNumber = [&](BoardState& state, std::string_view str) {
-    auto [p, ec] = std::from_chars(str.data(), str.data() + str.size(), state.mFullMove);
-    if (ec != std::errc()) {
-      throw std::runtime_error{"Invalid full move value"};
+  auto scratch = MoveList{};
+  auto san     = SanText{};
+  writeSan(move, piece, getOtherOrigins(move, piece), getCheckInfo(), scratch, san);
+  return std::string{san.view()};
+}
+// -------------------------------------------------------------------------------------------------
+void BoardState::getSanForMoves(MoveList const& legalMoves, SanText* out) const
+{
+  // Our pieces by square, so each move looks its piece up once
+  Piece mailbox[64];
+  std::fill(std::begin(mailbox), std::end(mailbox), PieceNone);
+  for (auto piece = 0; piece < PieceCount; ++piece) {
+    for (auto b = mPieces[mTurn][piece]; b;) {
+      mailbox[b.popLsb()] = static_cast<Piece>(piece);
     }
-  };
+  }
 
-  BoardState state;
-
-  if (variant == ChessVariant::Standard) {
-    if (fields.size() == 6) {
-      parsePiecePlacement(state, fields[0]);
-      parsePlayerTurn(state, fields[1]);
-      parseCastlingAvailability(state, fields[2]);
-      parseEnPassantSquare(state, fields[3]);
-      parseHalfMoveNumber(state, fields[4]);
-      parseFullMoveNumber(state, fields[5]);
-    } else if (fields.size() == 4) {
-      parsePiecePlacement(state, fields[0]);
-      parsePlayerTurn(state, fields[1]);
-      parseCastlingAvailability(state, fields[2]);
-      parseEnPassantSquare(state, fields[3]);
-      state.mHalfMoves = 0;
-      state.mFullMove  = 1;
-    } else {
-      throw std::runtime_error{"Malformed FEN string"};
+  // Origins of the legal moves of each piece type to each square, for disambiguation
+  Bitboard origins[PieceCount][64] = {};
+  for (auto const& move : legalMoves) {
+    if (!move.isCastling()) {
+      auto const from = move.fromSquare();
+      origins[mailbox[static_cast<int>(from)]][static_cast<int>(move.toSquare())] |= from;
     }
-  } else {
-    throw std::runtime_error{"Unsupported chess variant"};
   }
 
-  state.updateNonPieceBitboards();
+  auto const info    = getCheckInfo();
+  auto       scratch = MoveList{};
+  for (auto i = std::size_t{0}; i < legalMoves.size(); ++i) {
+    auto const& move = legalMoves[i];
+    if (move.isCastling()) {
+      writeSan(move, PieceKing, Bitboard{}, info, scratch, out[i]);
+      continue;
+    }
 
-  return state;
+    auto const from   = move.fromSquare();
+    auto const piece  = mailbox[static_cast<int>(from)];
+    auto const others = piece == PiecePawn
+                            ? Bitboard{}
+                            : origins[piece][static_cast<int>(move.toSquare())] ^ from;
+    writeSan(move, piece, others, info, scratch, out[i]);
+  }
 }
 // -------------------------------------------------------------------------------------------------
-std::string BoardState::getSanForMove(UCIMove const& move) const
+void BoardState::getSanForLine(UCIMove const* moves, std::size_t count, SanText* out) const
 {
-  using namespace std::literals;
-  using std::to_string;
+  auto state   = *this;
+  auto scratch = MoveList{};
+  for (auto i = std::size_t{0}; i < count; ++i) {
+    auto const& move  = moves[i];
+    auto const  piece = move.isCastling() ? PieceKing : state.getPieceOn(move.fromSquare()).type;
+    CHESSGEN_ASSERT(piece != PieceNone);
+
+    state.writeSan(move, piece, state.getOtherOrigins(move, piece), state.getCheckInfo(), scratch,
+                   out[i]);
+    state.makeMove(move);
+  }
+}
+// -------------------------------------------------------------------------------------------------
+// Origins of the other legal moves of the same piece type to the same square, the squares that
+// SAN has to tell the mover apart from. Pawn moves always name their file when it matters and
+// there is a single king, so only the pieces in between need looking at
+Bitboard BoardState::getOtherOrigins(UCIMove const& move, Piece piece) const
+{
+  if (move.isCastling() || piece == PiecePawn || piece == PieceKing) return Bitboard{};
 
-  auto const us   = mTurn;
   auto const from = move.fromSquare();
   auto const to   = move.toSquare();
+  auto       others =
+      piece == PieceKnight ? attacks::getNonSlidingAttacks(piece, to, mTurn)
+                           : attacks::getSlidingAttacks(piece, to, mOccupied);
+  others &= mPieces[mTurn][piece] ^ from;
+
+  for (auto b = others; b;) {
+    auto const other = makeSquare(b.popLsb());
+    if (!isLegalCandidate(UCIMove{other, to}, piece)) others ^= other;
+  }
+  return others;
+}
+// -------------------------------------------------------------------------------------------------
+// others holds the origins of the other legal moves of the same piece type to the same square
+void BoardState::writeSan(UCIMove const&   move,
+                          Piece            piece,
+                          Bitboard         others,
+                          CheckInfo const& info,
+                          MoveList&        scratch,
+                          SanText&         out) const
+{
+  static constexpr char pieceChars[PieceCount] = {'P', 'B', 'N', 'R', 'Q', 'K'};
 
-  auto appendSuffixes = [&](std::string san) {
-    if (isMoveMate(move))
-      san += '#';
-    else if (isMoveCheck(move))
-      san += '+';
-    return san;
-  };
-
+  auto p = out.chars;
   if (move.isCastling()) {
-    if (move.getCastleSide() == CastleSide::King) {
-      return appendSuffixes("O-O");
+    auto const text = move.getCastleSide() == CastleSide::King ? std::string_view{"O-O"}
+                                                                : std::string_view{"O-O-O"};
+    p = std::copy(text.begin(), text.end(), p);
+  } else {
+    auto const from = move.fromSquare();
+    auto const to   = move.toSquare();
+
+    if (piece == PiecePawn) {
+      // Diagonal pawn moves are captures, en passant included
+      if (getFile(from) != getFile(to)) {
+        *p++ = static_cast<char>('a' + static_cast<int>(getFile(from)));
+        *p++ = 'x';
+      }
     } else {
-      return appendSuffixes("O-O-O");
+      *p++ = pieceChars[piece];
+
+      // File if it tells the pieces apart, else the rank, else both
+      if (others) {
+        auto sameFile = false;
+        auto sameRank = false;
+        for (auto b = others; b;) {
+          auto const other = makeSquare(b.popLsb());
+          sameFile |= getFile(other) == getFile(from);
+          sameRank |= getRank(other) == getRank(from);
+        }
+        if (!sameFile || sameRank) *p++ = static_cast<char>('a' + static_cast<int>(getFile(from)));
+        if (sameFile) *p++ = static_cast<char>('1' + static_cast<int>(getRank(from)));
+      }
+      if (!isSquareEmpty(to)) *p++ = 'x';
     }
-  }
 
-  auto const piece     = getPieceOn(from).type;
-  auto const isCapture = isSquareEmpty(to);
+    *p++ = static_cast<char>('a' + static_cast<int>(getFile(to)));
+    *p++ = static_cast<char>('1' + static_cast<int>(getRank(to)));
 
-  if (piece == PieceNone) return "";
-
-  if (piece == PiecePawn) {
-    if (!isCapture) {
-      return appendSuffixes(to_string(to));
-    } else {
-      return appendSuffixes(to_string(getFile(from)) + 'x' + to_string(to));
+    if (move.promotedTo() != PieceNone) {
+      *p++ = '=';
+      *p++ = pieceChars[move.promotedTo()];
     }
   }
-  // If there are 2 pieces in position to make this move, we need to disambiguate it
-  auto attackers = getAttackers(us, to) & getPieces(us, piece);
-
-  CHESSGEN_ASSERT(!attackers.isZero());
-
-  auto san = [piece]() {
-    switch (piece) {
-      case PieceBishop:
-        return "B"s;
-      case PieceKnight:
-        return "N"s;
-      case PieceRook:
-        return "R"s;
-      case PieceQueen:
-        return "Q"s;
-      case PieceKing:
-        return "K"s;
-
-      // These should not happen
-      case PiecePawn:
-      case PieceNone:
-      default:
-        return "-"s;
-    }
-  }();
-
-  if (attackers.popCount() == 1) {
-    // Unambiguous
-    if (isCapture) {
-      san += 'x';
-    }
 
-    return appendSuffixes(san + to_string(to));
-  } else if (attackers.popCount() == 2) {
-    // 2 pieces attacking, disambiguate them by file or rank
-    auto attacker1 = makeSquare(attackers.popLsb());
-    auto attacker2 = makeSquare(attackers.popLsb());
-
-    if (getFile(attacker1) != getFile(attacker2))
-      san += to_string(getFile(from));
-    else
-      san += to_string(getRank(from));
-
-    if (isCapture) {
-      san += 'x';
-    }
-
-    return appendSuffixes(san + to_string(to));
-  } else {
-    san += to_string(from);
-
-    if (isCapture) {
-      san += 'x';
-    }
-    // 3 pieces or more require the full square for disambiguation
-    return appendSuffixes(san + to_string(to));
+  // Only checking moves need the reply generation that tells check from mate
+  if (givesCheck(move, piece, info)) {
+    auto next = *this;
+    next.makeMove(move);
+    scratch.clear();
+    generateMoves<GenType::Legal>(next, scratch);
+    *p++ = scratch.empty() ? '#' : '+';
   }
+
+  out.length = static_cast<std::uint8_t>(p - out.chars);
+  CHESSGEN_ASSERT(out.length < sizeof(out.chars));
 }
 // -------------------------------------------------------------------------------------------------
 int BoardState::getHalfMoves() const
@@ -384,14 +552,7 @@ Color BoardState::getActivePlayer() const
 // -------------------------------------------------------------------------------------------------
 bool BoardState::isInCheck() const
 {
-  auto const kingSquareIndex = getKingSquare(getActivePlayer());
-
-  // no king?
-  if (kingSquareIndex == Square::None) {
-    return false;
-  }
-
-  return isSquareUnderAttack(~getActivePlayer(), kingSquareIndex);
+  return !!(mAttacked[~mTurn] & mPieces[mTurn][PieceKing]);
 }
 // -------------------------------------------------------------------------------------------------
 bool BoardState::canShortCastle(Color color) const
@@ -402,21 +563,18 @@ bool BoardState::canShortCastle(Color color) const
     return false;
   }
 
-  auto       kingIndex  = getPieces(color, PieceKing).lsb();
-  auto const enemyColor = ~color;
+  auto const kingIndex = getPieces(color, PieceKing).lsb();
+  auto const rookSq    = getCastlingRookSquare(color, CastleSide::King);
+
+  // - The rook is no longer there (it was captured)
+  if (kingIndex == -1 || !(getPieces(color, PieceRook) & rookSq)) return false;
 
+  // - There are pieces between the king and the rook
   auto const squareMask = Bitboard((1ULL << (kingIndex + 1)) | (1ULL << (kingIndex + 2)));
   if (getOccupied() & squareMask) return false;
 
-  auto rookIndex = getPieces(color, PieceRook).msb();
-
-  // If there is no rook or if the only rook is the wrong one
-  if (rookIndex == -1 || rookIndex < kingIndex) return false;
-
-  // Or if one of the squares the king will move to is under attack
-  return !isSquareUnderAttack(enemyColor, makeSquare(kingIndex++)) &&
-         !isSquareUnderAttack(enemyColor, makeSquare(kingIndex++)) &&
-         !isSquareUnderAttack(enemyColor, makeSquare(kingIndex++));
+  // - The king is in check or one of the squares the king will move through is under attack
+  return !(getAttackedSquares(~color) & (squareMask | makeSquare(kingIndex)));
 }
 // -------------------------------------------------------------------------------------------------
 bool BoardState::canLongCastle(Color color) const
@@ -427,23 +585,24 @@ bool BoardState::canLongCastle(Color color) const
     return false;
   }
 
-  auto       kingIndex  = getPieces(color, PieceKing).msb();
-  auto const enemyColor = ~color;
+  auto const kingIndex = getPieces(color, PieceKing).msb();
+  auto const rookSq    = getCastlingRookSquare(color, CastleSide::Queen);
+
+  // - The rook is no longer there (it was captured)
+  if (kingIndex == -1 || !(getPieces(color, PieceRook) & rookSq)) return false;
 
+  // - There are pieces between the king and the rook
   auto const squareMask = Bitboard((1ULL << (kingIndex - 1)) |  //
                                    (1ULL << (kingIndex - 2)) |  //
                                    (1ULL << (kingIndex - 3)));
   if (getOccupied() & squareMask) return false;
 
-  auto rookIndex = getPieces(color, PieceRook).lsb();
-
-  // If there is no rook or if the only rook is the wrong one
-  if (rookIndex == -1 || rookIndex > kingIndex) return false;
-
-  // Or if one of the squares the king will move to is under attack
-  return !isSquareUnderAttack(enemyColor, makeSquare(kingIndex--)) &&
-         !isSquareUnderAttack(enemyColor, makeSquare(kingIndex--)) &&
-         !isSquareUnderAttack(enemyColor, makeSquare(kingIndex--));
+  // - The king is in check or one of the squares the king will move through is under attack.
+  //   The b-file square only needs to be empty, the king does not cross it
+  auto const kingPath = Bitboard((1ULL << kingIndex) |        //
+                                 (1ULL << (kingIndex - 1)) |  //
+                                 (1ULL << (kingIndex - 2)));
+  return !(getAttackedSquares(~color) & kingPath);
 }
 // -------------------------------------------------------------------------------------------------
 CastleSide BoardState::getCastlingRights(Color color) const
@@ -555,6 +714,11 @@ bool BoardState::isSquareUnderAttack(Color enemy, Square square) const
   return !king.isZero();
 }
 // -------------------------------------------------------------------------------------------------
+Bitboard BoardState::getAttackedSquares(Color color) const
+{
+  return mAttacked[color];
+}
+// -------------------------------------------------------------------------------------------------
 PieceInfo BoardState::getPieceOn(Square sq) const
 {
   auto const pieces = {
@@ -629,24 +793,221 @@ Square BoardState::getEnPassantSquare() const
   return makeSquare(mEnPassant.lsb());
 }
 // -------------------------------------------------------------------------------------------------
-bool BoardState::isMoveCheck(UCIMove const& move) const
+std::uint64_t BoardState::getHash() const
 {
-  // TODO: Make this faster!
-  // We dont need to create a new board and generate all legal moves for it!
+  auto hash = std::uint64_t{0};
+  for (auto color : {ColorWhite, ColorBlack}) {
+    for (auto piece = 0; piece < PieceCount; ++piece) {
+      for (auto b = mPieces[color][piece]; b;) {
+        hash ^= _zobrist.pieces[color][piece][b.popLsb()];
+      }
+    }
+  }
 
-  auto temp = Board(*this);
-  if (!temp.makeMove(move)) return false;
-  return temp.isInCheck();
+  hash ^= _zobrist.castling[static_cast<int>(mCastleRights[ColorWhite]) |
+                            static_cast<int>(mCastleRights[ColorBlack]) << 2];
+  if (mEnPassant) {
+    hash ^= _zobrist.enPassant[static_cast<int>(getFile(getEnPassantSquare()))];
+  }
+  if (mTurn == ColorBlack) {
+    hash ^= _zobrist.blackToMove;
+  }
+  return hash;
+}
+// -------------------------------------------------------------------------------------------------
+BoardState::CheckInfo BoardState::getCheckInfo() const
+{
+  auto const us   = mTurn;
+  auto const them = ~us;
+
+  auto info        = CheckInfo{};
+  info.kingSquare  = getKingSquare(them);
+  info.discoverers = getKingBlockers(them) & getAllPieces(us);
+
+  auto const ksq = info.kingSquare;
+  info.checkSquares[PiecePawn]   = attacks::getNonSlidingAttacks(PiecePawn, ksq, them);
+  info.checkSquares[PieceKnight] = attacks::getNonSlidingAttacks(PieceKnight, ksq, them);
+  info.checkSquares[PieceBishop] = attacks::getSlidingAttacks(PieceBishop, ksq, mOccupied);
+  info.checkSquares[PieceRook]   = attacks::getSlidingAttacks(PieceRook, ksq, mOccupied);
+  info.checkSquares[PieceQueen]  = info.checkSquares[PieceBishop] | info.checkSquares[PieceRook];
+  info.checkSquares[PieceKing]   = Bitboard{};
+  return info;
+}
+// -------------------------------------------------------------------------------------------------
+bool BoardState::givesCheck(UCIMove const& move, Piece piece, CheckInfo const& info) const
+{
+  // Castling, en passant and promotions move or remove more than one piece, or change its type.
+  // They are rare enough to just be played out
+  if (move.isCastling() || move.isEnPassant() || move.promotedTo() != PieceNone) {
+    auto next = *this;
+    return next.makeMove(move) && next.isInCheck();
+  }
+
+  auto const from = move.fromSquare();
+  auto const to   = move.toSquare();
+
+  // So are en passant captures that come without the flag set
+  if (piece == PiecePawn && getFile(from) != getFile(to) && isSquareEmpty(to)) {
+    auto next = *this;
+    return next.makeMove(move) && next.isInCheck();
+  }
+
+  // Direct check
+  if (info.checkSquares[piece] & to) {
+    return true;
+  }
+
+  // Discovered check: the piece was blocking one of our sliders and leaves its line
+  return (info.discoverers & from) && !attacks::aligned(from, to, info.kingSquare);
+}
+// -------------------------------------------------------------------------------------------------
+bool BoardState::givesCheck(UCIMove const& move) const
+{
+  auto const piece = move.isCastling() ? PieceKing : getPieceOn(move.fromSquare()).type;
+  return piece != PieceNone && givesCheck(move, piece, getCheckInfo());
+}
+// -------------------------------------------------------------------------------------------------
+bool BoardState::isMoveCheck(UCIMove const& move) const
+{
+  return givesCheck(move);
 }
 // -------------------------------------------------------------------------------------------------
 bool BoardState::isMoveMate(UCIMove const& move) const
 {
-  // TODO: Make this faster!
-  // We dont need to create a new board and generate all legal moves for it!
+  if (!givesCheck(move)) return false;
 
-  auto temp = Board(*this);
-  if (!temp.makeMove(move)) return false;
-  return temp.isOver() && temp.getGameOverReason() == GameOverReason::Mate;
+  auto next = *this;
+  next.makeMove(move);
+  return generateMoves<GenType::Legal>(next).empty();
+}
+// -------------------------------------------------------------------------------------------------
+bool BoardState::resolveSan(SANMove const& move, UCIMove& out) const
+{
+  auto const us = mTurn;
+
+  if (move.isCastling()) {
+    auto const side = move.getCastleSide();
+    if (side == CastleSide::King ? !canShortCastle(us) : !canLongCastle(us)) return false;
+
+    out = UCIMove{side};
+    return true;
+  }
+
+  auto fromMask = ~Bitboard{};
+  if (move.fromFile() != File::None) {
+    fromMask &= Bitboards::FileA << static_cast<int>(move.fromFile());
+  }
+  if (move.fromRank() != Rank::None) {
+    fromMask &= Bitboards::Rank1 << (8 * static_cast<int>(move.fromRank()));
+  }
+  return resolveOrigins(move.piece(), move.toSquare(), fromMask, move.promotedTo(), out);
+}
+// -------------------------------------------------------------------------------------------------
+bool BoardState::resolveMove(Square from, Square to, Piece promotedTo, UCIMove& out) const
+{
+  auto const us    = mTurn;
+  auto const piece = getPieceOn(from);
+  if (piece.type == PieceNone || piece.color != us) return false;
+
+  // Castling, as the king's two square move or as the king taking its own rook
+  if (piece.type == PieceKing && getRank(from) == getRank(to) && promotedTo == PieceNone) {
+    auto const distance = static_cast<int>(getFile(to)) - static_cast<int>(getFile(from));
+    if (distance == 2 || distance == -2 || (mPieces[us][PieceRook] & to)) {
+      auto const side = distance > 0 ? CastleSide::King : CastleSide::Queen;
+      if (side == CastleSide::King ? !canShortCastle(us) : !canLongCastle(us)) return false;
+      if ((mPieces[us][PieceRook] & to) && to != getCastlingRookSquare(us, side)) return false;
+
+      out = UCIMove{side};
+      return true;
+    }
+  }
+
+  return resolveOrigins(piece.type, to, Bitboard{} | from, promotedTo, out);
+}
+// -------------------------------------------------------------------------------------------------
+// Finds the legal move of a piece of the given type to to, from one of the squares in fromMask
+bool BoardState::resolveOrigins(Piece    piece,
+                                Square   to,
+                                Bitboard fromMask,
+                                Piece    promotedTo,
+                                UCIMove& out) const
+{
+  auto const us   = mTurn;
+  auto const them = ~us;
+  if (piece == PieceNone || (mAllPieces[us] & to)) return false;
+
+  // Where a piece of this type could have come from. Attacks are symmetric, so these are the
+  // squares it attacks from the target, with pawns looking the other way
+  auto const enPassant = piece == PiecePawn && !!(mEnPassant & to);
+  auto       origins   = Bitboard{};
+  if (piece == PiecePawn) {
+    if ((mAllPieces[them] & to) || enPassant) {
+      origins = attacks::getNonSlidingAttacks(PiecePawn, to, them);
+    } else if (us == ColorWhite ? getRank(to) >= Rank::Rank3 : getRank(to) <= Rank::Rank6) {
+      auto const behind = to - (us == ColorWhite ? Direction::North : Direction::South);
+      auto const start  = us == ColorWhite ? Rank::Rank4 : Rank::Rank5;
+      origins |= behind;
+      if (getRank(to) == start && isSquareEmpty(behind)) {
+        origins |= behind - (us == ColorWhite ? Direction::North : Direction::South);
+      }
+    }
+  } else if (piece == PieceKnight || piece == PieceKing) {
+    origins = attacks::getNonSlidingAttacks(piece, to, us);
+  } else {
+    origins = attacks::getSlidingAttacks(piece, to, mOccupied);
+  }
+  origins &= mPieces[us][piece] & fromMask;
+
+  // Pawns reaching the last rank have to say what they promote to, and nothing else may
+  auto const lastRank  = us == ColorWhite ? Rank::Rank8 : Rank::Rank1;
+  auto const promotion = promotedTo != PieceNone;
+  if ((piece == PiecePawn && getRank(to) == lastRank) != promotion) return false;
+  if (promotion && (promotedTo == PiecePawn || promotedTo == PieceKing)) return false;
+
+  while (origins) {
+    auto const from      = makeSquare(origins.popLsb());
+    auto const candidate = enPassant   ? UCIMove{from, to, UCIMove::EnPassant}
+                           : promotion ? UCIMove{from, to, promotedTo}
+                                       : UCIMove{from, to};
+    if (isLegalCandidate(candidate, piece)) {
+      out = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+// -------------------------------------------------------------------------------------------------
+// Whether a move that is known to be pseudo-legal is legal
+bool BoardState::isLegalCandidate(UCIMove const& move, Piece piece) const
+{
+  auto const us   = mTurn;
+  auto const them = ~us;
+  auto const from = move.fromSquare();
+  auto const to   = move.toSquare();
+  auto const ksq  = getKingSquare(us);
+
+  // The attack map already sees through our king
+  if (piece == PieceKing) {
+    return !(mAttacked[them] & to);
+  }
+
+  // En passant removes a piece off the target square, just play it out
+  if (move.isEnPassant()) {
+    auto next = *this;
+    next.makeMove(move);
+    return !next.isSquareUnderAttack(them, ksq);
+  }
+
+  // In check, the move has to capture the single checker or block it
+  if (auto const checkers = getCheckers()) {
+    if (checkers.moreThanOne()) return false;
+
+    auto const checksq = makeSquare(checkers.lsb());
+    if (!((Bitboard::getLineBetween(checksq, ksq) | checksq) & to)) return false;
+  }
+
+  // And a pinned piece may only move along the pin
+  return !(getKingBlockers(us) & from) || attacks::aligned(from, to, ksq);
 }
 // -------------------------------------------------------------------------------------------------
 Bitboard BoardState::getAttackers(Color color, Square square) const
@@ -814,6 +1175,14 @@ bool BoardState::makeMove(UCIMove const& move)
         removePiece(captured, them, to + behind);
       else
         removePiece(captured, them, to);
+
+      // Capturing a rook on its original square takes away that castling right
+      if (captured == PieceRook) {
+        if (to == getCastlingRookSquare(them, CastleSide::King))
+          mCastleRights[them] = mCastleRights[them] & ~CastleSide::King;
+        else if (to == getCastlingRookSquare(them, CastleSide::Queen))
+          mCastleRights[them] = mCastleRights[them] & ~CastleSide::Queen;
+      }
     }
 
     movePiece(getPieceOn(from).type, us, from, to);
@@ -830,6 +1199,8 @@ bool BoardState::makeMove(UCIMove const& move)
 
   mTurn = ~mTurn;
 
+  updateAttackMaps();
+
   return true;
 }
 }  // namespace chessgen
@@ -0,0 +1,290 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "chessgen/game_history.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace chessgen
+{
+namespace
+{
+// Packed move layout: from (6 bits), to (6 bits), kind (2 bits), extra (2 bits). The extra bits
+// hold the promotion piece or the castling side
+enum MoveKind : std::uint16_t {
+  KindNormal    = 0,
+  KindPromotion = 1,
+  KindEnPassant = 2,
+  KindCastling  = 3,
+};
+}  // namespace
+
+// -------------------------------------------------------------------------------------------------
+// A checkpoint and the moves played from it. Only the newest chunk of a history is ever partially
+// filled; older chunks hold exactly mInterval moves and are never modified while shared
+struct GameHistory::Chunk {
+  BoardState                      checkpoint;
+  std::size_t                     firstPly;
+  std::pmr::vector<std::uint16_t> moves;
+  std::shared_ptr<Chunk>          parent;
+};
+
+// -------------------------------------------------------------------------------------------------
+GameHistory::GameHistory() : GameHistory(BoardState{})
+{
+}
+// -------------------------------------------------------------------------------------------------
+GameHistory::GameHistory(BoardState                 initial,
+                         int                        checkpointInterval,
+                         std::pmr::memory_resource* resource)
+    : mResource{resource},
+      mTail{newChunk(initial, 0, nullptr)},
+      mLast{std::move(initial)},
+      mInterval{checkpointInterval}
+{
+  CHESSGEN_ASSERT(checkpointInterval >= 1);
+}
+// -------------------------------------------------------------------------------------------------
+// The control block, the chunk and its moves all come from our resource
+std::shared_ptr<GameHistory::Chunk> GameHistory::newChunk(BoardState const&      checkpoint,
+                                                          std::size_t            firstPly,
+                                                          std::shared_ptr<Chunk> parent) const
+{
+  auto const allocator = std::pmr::polymorphic_allocator<Chunk>{mResource};
+  return std::allocate_shared<Chunk>(
+      allocator, Chunk{checkpoint, firstPly, std::pmr::vector<std::uint16_t>{mResource},
+                       std::move(parent)});
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t GameHistory::size() const
+{
+  return mSize;
+}
+// -------------------------------------------------------------------------------------------------
+BoardState const& GameHistory::back() const
+{
+  return mLast;
+}
+// -------------------------------------------------------------------------------------------------
+GameHistory::Chunk const* GameHistory::findChunk(std::size_t ply) const
+{
+  auto chunk = static_cast<Chunk const*>(mTail.get());
+  while (chunk->firstPly > ply) {
+    chunk = chunk->parent.get();
+  }
+  return chunk;
+}
+// -------------------------------------------------------------------------------------------------
+BoardState GameHistory::getState(std::size_t ply) const
+{
+  CHESSGEN_ASSERT(ply < size());
+
+  if (ply + 1 == mSize) {
+    return mLast;
+  }
+  return rebuild(ply);
+}
+// -------------------------------------------------------------------------------------------------
+BoardState GameHistory::rebuild(std::size_t ply) const
+{
+  auto const chunk = findChunk(ply);
+  auto       state = chunk->checkpoint;
+  for (auto i = chunk->firstPly; i < ply; ++i) {
+    state.makeMove(unpackMove(chunk->moves[i - chunk->firstPly]));
+  }
+  return state;
+}
+// -------------------------------------------------------------------------------------------------
+UCIMove GameHistory::getMove(std::size_t ply) const
+{
+  CHESSGEN_ASSERT(ply + 1 < size());
+
+  auto const chunk = findChunk(ply);
+  return unpackMove(chunk->moves[ply - chunk->firstPly]);
+}
+// -------------------------------------------------------------------------------------------------
+// Chunks are linked from the newest, so fill the list from the back. The newest chunk may hold
+// moves past our last ply, which are skipped
+MoveList GameHistory::getMoves() const
+{
+  auto moves = MoveList(mSize - 1);
+  for (auto chunk = static_cast<Chunk const*>(mTail.get()); chunk; chunk = chunk->parent.get()) {
+    auto const count = std::min(chunk->moves.size(), moves.size() - chunk->firstPly);
+    for (auto i = std::size_t{0}; i < count; ++i) {
+      moves[chunk->firstPly + i] = unpackMove(chunk->moves[i]);
+    }
+  }
+  return moves;
+}
+// -------------------------------------------------------------------------------------------------
+int GameHistory::getCheckpointInterval() const
+{
+  return mInterval;
+}
+// -------------------------------------------------------------------------------------------------
+std::pmr::memory_resource* GameHistory::getMemoryResource() const
+{
+  return mResource;
+}
+// -------------------------------------------------------------------------------------------------
+void GameHistory::setCheckpointInterval(int checkpointInterval)
+{
+  CHESSGEN_ASSERT(checkpointInterval >= 1);
+
+  if (checkpointInterval == mInterval) {
+    return;
+  }
+
+  auto rebuilt = GameHistory{getState(0), checkpointInterval, mResource};
+  auto state   = rebuilt.back();
+  for (auto ply = std::size_t{0}; ply + 1 < mSize; ++ply) {
+    auto const move = getMove(ply);
+    state.makeMove(move);
+    rebuilt.push(move, state);
+  }
+
+  *this = std::move(rebuilt);
+}
+// -------------------------------------------------------------------------------------------------
+void GameHistory::push(UCIMove const& move, BoardState const& next)
+{
+  auto const used = mSize - 1 - mTail->firstPly;
+
+  // Never append to a chunk another history can see. The chunk may also hold moves past our last
+  // ply, either played by the fork we were copied from or undone by pop
+  if (mTail.use_count() > 1) {
+    auto copy = newChunk(mTail->checkpoint, mTail->firstPly, mTail->parent);
+    copy->moves.reserve(static_cast<std::size_t>(mInterval));
+    copy->moves.assign(mTail->moves.begin(), mTail->moves.begin() + used);
+    mTail = std::move(copy);
+  } else {
+    // The last other owner may have just let go from another thread (a PositionSnapshot, say).
+    // Pair with its release so its reads of the chunk happen before our writes
+    std::atomic_thread_fence(std::memory_order_acquire);
+    mTail->moves.resize(used);
+  }
+
+  if (mTail->moves.capacity() == 0) {
+    mTail->moves.reserve(static_cast<std::size_t>(mInterval));
+  }
+  mTail->moves.push_back(packMove(move));
+  ++mSize;
+
+  if (mTail->moves.size() == static_cast<std::size_t>(mInterval)) {
+    mTail = takeChunk(next, mSize - 1, std::move(mTail));
+  }
+  mLast = next;
+}
+// -------------------------------------------------------------------------------------------------
+void GameHistory::pop()
+{
+  CHESSGEN_ASSERT(size() > 1);
+
+  --mSize;
+  if (mTail->firstPly + 1 > mSize) {
+    mTail = mTail->parent;
+  }
+  mLast = rebuild(mSize - 1);
+}
+// -------------------------------------------------------------------------------------------------
+// The chunks no other history shares go to the spare list, so the next game does not allocate
+// until it grows longer than this one
+void GameHistory::reset(BoardState const& initial)
+{
+  // Same as in push, another owner may just have let go
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  auto chunk = std::move(mTail);
+  while (chunk && chunk.use_count() == 1) {
+    auto parent   = std::move(chunk->parent);
+    chunk->parent = std::move(mSpare);
+    mSpare        = std::move(chunk);
+    chunk         = std::move(parent);
+  }
+  chunk.reset();
+
+  mTail = takeChunk(initial, 0, nullptr);
+  mLast = initial;
+  mSize = 1;
+}
+// -------------------------------------------------------------------------------------------------
+// A copy of this history shares the spare list too. Whoever finds it shared lets go of it, so a
+// spare chunk is only ever reused by one history
+std::shared_ptr<GameHistory::Chunk> GameHistory::takeChunk(BoardState const&      checkpoint,
+                                                           std::size_t            firstPly,
+                                                           std::shared_ptr<Chunk> parent)
+{
+  if (!mSpare || mSpare.use_count() > 1) {
+    mSpare.reset();
+    return newChunk(checkpoint, firstPly, std::move(parent));
+  }
+
+  auto chunk        = std::move(mSpare);
+  mSpare            = std::move(chunk->parent);
+  chunk->checkpoint = checkpoint;
+  chunk->firstPly   = firstPly;
+  chunk->moves.clear();
+  chunk->parent = std::move(parent);
+  return chunk;
+}
+// -------------------------------------------------------------------------------------------------
+std::uint16_t GameHistory::packMove(UCIMove const& move)
+{
+  if (move.isCastling()) {
+    auto const side = move.getCastleSide() == CastleSide::King ? 0 : 1;
+    return static_cast<std::uint16_t>(KindCastling << 12 | side << 14);
+  }
+
+  auto const from = static_cast<unsigned>(move.fromSquare());
+  auto const to   = static_cast<unsigned>(move.toSquare()) << 6;
+
+  if (move.isPromotion()) {
+    // Bishop, Knight, Rook and Queen are 1 to 4
+    auto const piece = static_cast<unsigned>(move.promotedTo()) - 1;
+    return static_cast<std::uint16_t>(from | to | KindPromotion << 12 | piece << 14);
+  }
+  if (move.isEnPassant()) {
+    return static_cast<std::uint16_t>(from | to | KindEnPassant << 12);
+  }
+  return static_cast<std::uint16_t>(from | to);
+}
+// -------------------------------------------------------------------------------------------------
+UCIMove GameHistory::unpackMove(std::uint16_t packed)
+{
+  auto const from  = makeSquare(packed & 0x3f);
+  auto const to    = makeSquare((packed >> 6) & 0x3f);
+  auto const extra = packed >> 14;
+
+  switch (MoveKind((packed >> 12) & 3)) {
+    case KindPromotion:
+      return UCIMove{from, to, Piece(extra + 1)};
+    case KindEnPassant:
+      return UCIMove{from, to, UCIMove::EnPassant};
+    case KindCastling:
+      return UCIMove{extra == 0 ? CastleSide::King : CastleSide::Queen};
+    case KindNormal:
+    default:
+      return UCIMove{from, to};
+  }
+}
+}  // namespace chessgen
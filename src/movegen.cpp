@@ -31,16 +31,16 @@
 namespace chessgen
 {
 template <Color Us, GenType Type>
-void generateAll(class BoardState const& state, Bitboard target, std::vector<UCIMove>& moves);
+void generateAll(class BoardState const& state, Bitboard target, MoveList& moves);
 // -------------------------------------------------------------------------------------------------
 template <Color Us>
-void generateDiscoveredChecks(class BoardState const& state, std::vector<UCIMove>& moves);
+void generateDiscoveredChecks(class BoardState const& state, MoveList& moves);
 // -------------------------------------------------------------------------------------------------
 template <Color Us, Piece PieceType, GenType Type>
-void generatePieceMoves(class BoardState const& state, Bitboard target, std::vector<UCIMove>& moves);
+void generatePieceMoves(class BoardState const& state, Bitboard target, MoveList& moves);
 // -------------------------------------------------------------------------------------------------
 template <Color Us, GenType Type>
-void generatePawnMoves(class BoardState const& state, Bitboard target, std::vector<UCIMove>& moves);
+void generatePawnMoves(class BoardState const& state, Bitboard target, MoveList& moves);
 // -------------------------------------------------------------------------------------------------
 bool legalityCheck(class BoardState const& state, UCIMove const& move);
 // -------------------------------------------------------------------------------------------------
@@ -78,18 +78,18 @@ bool legalityCheck(class BoardState const& state, UCIMove const& move)
   }
 
   // If the moving piece is a king, check whether the destination square is
-  // attacked by the opponent.
+  // attacked by the opponent. The attack map already sees through our king.
   if (ksq == from) {
-    return !state.isSquareUnderAttack(~us, to);
+    return !(state.getAttackedSquares(~us) & to);
   }
 
   // A non-king move is legal if and only if it is not pinned or it
   // is moving along the ray towards or away from the king.
-  return !(state.getKingBlockers(us) & from) || (attacks::getLineBetween(from, to) & ksq);
+  return !(state.getKingBlockers(us) & from) || attacks::aligned(from, to, ksq);
 }
 // -------------------------------------------------------------------------------------------------
 template <Color Us>
-void generateDiscoveredChecks(class BoardState const& state, std::vector<UCIMove>& moves)
+void generateDiscoveredChecks(class BoardState const& state, MoveList& moves)
 {
   constexpr auto Them = ~Us;
 
@@ -124,7 +124,7 @@ void generateDiscoveredChecks(class BoardState const& state, std::vector<UCIMove
 }
 // -------------------------------------------------------------------------------------------------
 template <Color Us, Piece PieceType, GenType Type>
-void generatePieceMoves(class BoardState const& state, Bitboard target, std::vector<UCIMove>& moves)
+void generatePieceMoves(class BoardState const& state, Bitboard target, MoveList& moves)
 {
   CHESSGEN_ASSERT(PieceType != PieceKing);
 
@@ -152,7 +152,7 @@ template <Color Us, GenType Type, Direction D>
 void makePromotions([[maybe_unused]] BoardState const&     state,
                     [[maybe_unused]] Square                to,
                     [[maybe_unused]] Square                ksq,
-                    [[maybe_unused]] std::vector<UCIMove>& moves)
+                    [[maybe_unused]] MoveList&             moves)
 {
   if constexpr (Type == GenType::Captures || Type == GenType::Evasions || Type == GenType::NonEvasions)
     moves.emplace_back(to - D, to, PieceQueen);
@@ -167,7 +167,7 @@ void makePromotions([[maybe_unused]] BoardState const&     state,
 }
 // -------------------------------------------------------------------------------------------------
 template <Color Us, GenType Type>
-void generatePawnMoves(class BoardState const& state, Bitboard target, std::vector<UCIMove>& moves)
+void generatePawnMoves(class BoardState const& state, Bitboard target, MoveList& moves)
 {
   // clang-format off
   [[maybe_unused]] constexpr auto Them    = (Us == ColorWhite ? ColorBlack : ColorWhite);
@@ -315,15 +315,14 @@ void generatePawnMoves(class BoardState const& state, Bitboard target, std::vect
  * Other move types are handled by their respective specializations below
  */
 template <GenType Type>
-auto generateMoves(class BoardState const& state) -> std::vector<UCIMove>
+void generateMoves(class BoardState const& state, MoveList& moves)
 {
   CHESSGEN_ASSERT(Type == GenType::Captures || Type == GenType::Quiets || Type == GenType::NonEvasions);
   CHESSGEN_ASSERT(!state.isInCheck());
   CHESSGEN_ASSERT(!state.getCheckers());
 
-  auto       moves = std::vector<UCIMove>{};
-  auto const us    = state.getActivePlayer();
-  auto const them  = ~us;
+  auto const us   = state.getActivePlayer();
+  auto const them = ~us;
 
   auto const target = [&] {
     // clang-format off
@@ -338,18 +337,15 @@ auto generateMoves(class BoardState const& state) -> std::vector<UCIMove>
     generateAll<ColorWhite, Type>(state, target, moves);
   else
     generateAll<ColorBlack, Type>(state, target, moves);
-
-  return moves;
 }
-template std::vector<UCIMove> generateMoves<GenType::Captures>(class BoardState const& state);
-template std::vector<UCIMove> generateMoves<GenType::Quiets>(class BoardState const& state);
-template std::vector<UCIMove> generateMoves<GenType::NonEvasions>(class BoardState const& state);
+template void generateMoves<GenType::Captures>(class BoardState const&, MoveList&);
+template void generateMoves<GenType::Quiets>(class BoardState const&, MoveList&);
+template void generateMoves<GenType::NonEvasions>(class BoardState const&, MoveList&);
 // -------------------------------------------------------------------------------------------------
 template <>
-auto generateMoves<GenType::QuietChecks>(class BoardState const& state) -> std::vector<UCIMove>
+void generateMoves<GenType::QuietChecks>(class BoardState const& state, MoveList& moves)
 {
-  auto       moves = std::vector<UCIMove>{};
-  auto const us    = state.getActivePlayer();
+  auto const us = state.getActivePlayer();
 
   CHESSGEN_ASSERT(!state.isInCheck());
   CHESSGEN_ASSERT(!state.getCheckers());
@@ -361,12 +357,10 @@ auto generateMoves<GenType::QuietChecks>(class BoardState const& state) -> std::
     generateDiscoveredChecks<ColorBlack>(state, moves);
     generateAll<ColorBlack, GenType::QuietChecks>(state, state.getUnoccupied(), moves);
   }
-
-  return moves;
 }
 // -------------------------------------------------------------------------------------------------
 template <>
-auto generateMoves<GenType::Evasions>(class BoardState const& state) -> std::vector<UCIMove>
+void generateMoves<GenType::Evasions>(class BoardState const& state, MoveList& moves)
 {
   auto const us = state.getActivePlayer();
 
@@ -374,23 +368,12 @@ auto generateMoves<GenType::Evasions>(class BoardState const& state) -> std::vec
   CHESSGEN_ASSERT(state.isInCheck());
   CHESSGEN_ASSERT(state.getCheckers());
 
-  auto moves         = std::vector<UCIMove>{};
-  auto ksq           = state.getKingSquare(us);
-  auto sliderAttacks = Bitboard{};
-  auto sliders       = state.getCheckers() &     //
-                 ~state.getPieces(PiecePawn) &   //
-                 ~state.getPieces(PieceKnight);  //
-
-  // Find all the squares attacked by slider checkers. We will remove them from
-  // the king evasions in order to skip known illegal moves, which avoids any
-  // useless legality checks later on.
-  while (sliders) {
-    auto const checksq = makeSquare(sliders.popLsb());
-    sliderAttacks |= attacks::getLineBetween(checksq, ksq) ^ checksq;
-  }
+  auto ksq = state.getKingSquare(us);
 
-  // Generate evasions for king, capture and non capture moves
-  auto b = state.getPossibleMoves(PieceKing, us, ksq) & ~state.getAllPieces(us) & ~sliderAttacks;
+  // Generate evasions for king, capture and non capture moves. The enemy attack map is computed
+  // without our king on the board, so squares further along the ray of a slider checker are
+  // already excluded and every one of these moves is legal.
+  auto b = state.getPossibleMoves(PieceKing, us, ksq) & ~state.getAttackedSquares(~us);
   while (b) {
     moves.emplace_back(ksq, makeSquare(b.popLsb()));
   }
@@ -398,7 +381,7 @@ auto generateMoves<GenType::Evasions>(class BoardState const& state) -> std::vec
   auto const checkers = state.getCheckers();
 
   // Double check?
-  if (checkers.moreThanOne()) return moves;
+  if (checkers.moreThanOne()) return;
 
   // Generate blocking evasions or captures of the checking piece
   auto const checksq = makeSquare(checkers.lsb());
@@ -408,12 +391,10 @@ auto generateMoves<GenType::Evasions>(class BoardState const& state) -> std::vec
     generateAll<ColorWhite, GenType::Evasions>(state, target, moves);
   else
     generateAll<ColorBlack, GenType::Evasions>(state, target, moves);
-
-  return moves;
 }
 // -------------------------------------------------------------------------------------------------
 template <>
-auto generateMoves<GenType::Legal>(class BoardState const& state) -> std::vector<UCIMove>
+void generateMoves<GenType::Legal>(class BoardState const& state, MoveList& moves)
 {
   auto const us           = state.getActivePlayer();
   auto const pinnedPieces = state.getKingBlockers(us) & state.getAllPieces(us);
@@ -421,13 +402,14 @@ auto generateMoves<GenType::Legal>(class BoardState const& state) -> std::vector
 
   CHESSGEN_ASSERT(ksq != Square::None);
 
-  auto moves = std::vector<UCIMove>{};
+  auto const first = moves.size();
   if (state.isInCheck())
-    moves = generateMoves<GenType::Evasions>(state);
+    generateMoves<GenType::Evasions>(state, moves);
   else
-    moves = generateMoves<GenType::NonEvasions>(state);
+    generateMoves<GenType::NonEvasions>(state, moves);
 
-  auto newEnd = std::remove_if(moves.begin(), moves.end(), [&](UCIMove const& move) {
+  auto const begin  = moves.begin() + static_cast<std::ptrdiff_t>(first);
+  auto const newEnd = std::remove_if(begin, moves.end(), [&](UCIMove const& move) {
     // There are 2 situations in which a pseudo-legal move can be illegal:
     // - If there are pinned pieces, it cannot be moved in a way that places the king in check
     // - If we are moving the king, it must not be placed in check
@@ -443,12 +425,30 @@ auto generateMoves<GenType::Legal>(class BoardState const& state) -> std::vector
   });
 
   moves.erase(newEnd, moves.end());
-
+}
+// -------------------------------------------------------------------------------------------------
+template <GenType Type>
+auto generateMoves(class BoardState const& state, std::pmr::memory_resource* resource) -> MoveList
+{
+  auto moves = MoveList{resource};
+  generateMoves<Type>(state, moves);
   return moves;
 }
+template MoveList generateMoves<GenType::Quiets>(class BoardState const&,
+                                                 std::pmr::memory_resource*);
+template MoveList generateMoves<GenType::QuietChecks>(class BoardState const&,
+                                                      std::pmr::memory_resource*);
+template MoveList generateMoves<GenType::Captures>(class BoardState const&,
+                                                   std::pmr::memory_resource*);
+template MoveList generateMoves<GenType::NonEvasions>(class BoardState const&,
+                                                      std::pmr::memory_resource*);
+template MoveList generateMoves<GenType::Evasions>(class BoardState const&,
+                                                   std::pmr::memory_resource*);
+template MoveList generateMoves<GenType::Legal>(class BoardState const&,
+                                                std::pmr::memory_resource*);
 // -------------------------------------------------------------------------------------------------
 template <Color Us, GenType Type>
-void generateAll(class BoardState const& state, Bitboard target, std::vector<UCIMove>& moves)
+void generateAll(class BoardState const& state, Bitboard target, MoveList& moves)
 {
   generatePieceMoves<Us, PiecePawn, Type>(state, target, moves);
   generatePieceMoves<Us, PieceKnight, Type>(state, target, moves);
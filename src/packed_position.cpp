@@ -0,0 +1,170 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "chessgen/packed_position.hpp"
+
+#include "chessgen/helpers.hpp"
+
+namespace chessgen
+{
+// Stable piece codes of the record format, indexed by Piece
+static constexpr std::uint8_t _pieceCodes[PieceCount] = {
+    1,  // PiecePawn
+    3,  // PieceBishop
+    2,  // PieceKnight
+    4,  // PieceRook
+    5,  // PieceQueen
+    6,  // PieceKing
+};
+static constexpr Piece _codePieces[8] = {
+    PieceNone, PiecePawn, PieceKnight, PieceBishop, PieceRook, PieceQueen, PieceKing, PieceNone,
+};
+
+static constexpr std::uint8_t _blackNibble  = 0x8;
+static constexpr std::uint8_t _blackToMove  = 0x1;
+static constexpr std::uint8_t _hasEnPassant = 0x80;
+
+// Castling flags in byte 24, indexed by color and then king side / queen side
+static constexpr std::uint8_t _castleFlags[ColorCount][2] = {{0x2, 0x4}, {0x8, 0x10}};
+
+// -------------------------------------------------------------------------------------------------
+static void storeLittleEndian(std::uint8_t* out, std::uint64_t value, int bytes)
+{
+  for (auto i = 0; i < bytes; ++i) {
+    out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+  }
+}
+// -------------------------------------------------------------------------------------------------
+static std::uint64_t loadLittleEndian(std::uint8_t const* in, int bytes)
+{
+  auto value = std::uint64_t{0};
+  for (auto i = 0; i < bytes; ++i) {
+    value |= std::uint64_t{in[i]} << (8 * i);
+  }
+  return value;
+}
+// -------------------------------------------------------------------------------------------------
+PackedPosition::PackedPosition(std::array<std::uint8_t, Size> const& bytes) : mBytes(bytes)
+{
+}
+// -------------------------------------------------------------------------------------------------
+std::array<std::uint8_t, PackedPosition::Size> const& PackedPosition::getBytes() const
+{
+  return mBytes;
+}
+// -------------------------------------------------------------------------------------------------
+bool PackedPosition::encode(BoardState const& state, PackedPosition& out)
+{
+  auto const occupied = state.getOccupied();
+  if (occupied.popCount() > 32 || state.mHalfMoves < 0 || state.mHalfMoves > 0xFFFF ||
+      state.mFullMove < 0 || state.mFullMove > 0xFFFF) {
+    return false;
+  }
+
+  // Nibble codes of every square, then gathered in square order below
+  std::uint8_t codes[64] = {};
+  for (auto color : {ColorWhite, ColorBlack}) {
+    auto const colorBit = color == ColorBlack ? _blackNibble : std::uint8_t{0};
+    for (auto piece = 0; piece < PieceCount; ++piece) {
+      for (auto b = state.mPieces[color][piece]; b;) {
+        codes[b.popLsb()] = static_cast<std::uint8_t>(_pieceCodes[piece] | colorBit);
+      }
+    }
+  }
+
+  auto bytes = std::array<std::uint8_t, Size>{};
+  storeLittleEndian(&bytes[0], occupied.getBits(), 8);
+
+  auto nibble = 0;
+  for (auto b = occupied; b; ++nibble) {
+    bytes[8 + nibble / 2] |= static_cast<std::uint8_t>(codes[b.popLsb()] << (4 * (nibble % 2)));
+  }
+
+  auto flags = state.mTurn == ColorBlack ? _blackToMove : std::uint8_t{0};
+  for (auto color : {ColorWhite, ColorBlack}) {
+    if (enumHasFlag(state.mCastleRights[color], CastleSide::King)) flags |= _castleFlags[color][0];
+    if (enumHasFlag(state.mCastleRights[color], CastleSide::Queen)) flags |= _castleFlags[color][1];
+  }
+  bytes[24] = flags;
+  bytes[25] = state.mEnPassant ? static_cast<std::uint8_t>(_hasEnPassant | state.mEnPassant.lsb())
+                               : std::uint8_t{0};
+  storeLittleEndian(&bytes[26], static_cast<std::uint64_t>(state.mHalfMoves), 2);
+  storeLittleEndian(&bytes[28], static_cast<std::uint64_t>(state.mFullMove), 2);
+  bytes[30] = Version;
+
+  out.mBytes = bytes;
+  return true;
+}
+// -------------------------------------------------------------------------------------------------
+bool PackedPosition::decode(BoardState& out) const
+{
+  if (mBytes[30] != Version || mBytes[31] != 0 || (mBytes[24] & 0xE0) || (mBytes[25] & 0x40)) {
+    return false;
+  }
+
+  auto const occupied = Bitboard{loadLittleEndian(&mBytes[0], 8)};
+  auto const count    = occupied.popCount();
+  if (count > 32) {
+    return false;
+  }
+
+  auto state  = BoardState{};
+  auto nibble = 0;
+  for (auto b = occupied; b; ++nibble) {
+    auto const shift = 4 * (nibble % 2);
+    auto const code  = static_cast<std::uint8_t>(mBytes[8 + nibble / 2] >> shift & 0xF);
+    auto const piece = _codePieces[code & 0x7];
+    if (piece == PieceNone) {
+      return false;
+    }
+    auto const color = code & _blackNibble ? ColorBlack : ColorWhite;
+    state.mPieces[color][piece].setBit(static_cast<std::uint64_t>(b.popLsb()));
+  }
+
+  // Unused nibbles must be zero, or the record was not written by encode
+  for (; nibble < 32; ++nibble) {
+    if (mBytes[8 + nibble / 2] >> (4 * (nibble % 2)) & 0xF) {
+      return false;
+    }
+  }
+
+  auto const flags = mBytes[24];
+  state.mTurn      = flags & _blackToMove ? ColorBlack : ColorWhite;
+  for (auto color : {ColorWhite, ColorBlack}) {
+    auto rights = CastleSide::None;
+    if (flags & _castleFlags[color][0]) rights = rights | CastleSide::King;
+    if (flags & _castleFlags[color][1]) rights = rights | CastleSide::Queen;
+    state.mCastleRights[color] = rights;
+  }
+  if (mBytes[25] & _hasEnPassant) {
+    state.mEnPassant.setBit(mBytes[25] & 0x3Fu);
+  }
+  state.mHalfMoves = static_cast<int>(loadLittleEndian(&mBytes[26], 2));
+  state.mFullMove  = static_cast<int>(loadLittleEndian(&mBytes[28], 2));
+
+  state.updateNonPieceBitboards();
+  state.updateAttackMaps();
+
+  out = state;
+  return true;
+}
+}  // namespace chessgen
@@ -0,0 +1,135 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "chessgen/perft.hpp"
+
+#include <vector>
+
+#include "chessgen/movegen.hpp"
+
+namespace chessgen
+{
+namespace
+{
+constexpr int _depthBits = 8;
+constexpr int _depthMask = (1 << _depthBits) - 1;
+}  // namespace
+
+// -------------------------------------------------------------------------------------------------
+PerftTable::PerftTable(std::size_t megabytes)
+{
+  auto buckets = std::size_t{1};
+  while (buckets * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) {
+    buckets *= 2;
+  }
+
+  mBuckets.reset(new Bucket[buckets]);
+  mMask = buckets - 1;
+  clear();
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t PerftTable::getSize() const
+{
+  return (mMask + 1) * sizeof(Bucket);
+}
+// -------------------------------------------------------------------------------------------------
+bool PerftTable::probe(std::uint64_t hash, int depth, std::uint64_t& nodes) const
+{
+  for (auto const& entry : mBuckets[hash & mMask].entries) {
+    auto const data  = entry.data.load(std::memory_order_relaxed);
+    auto const check = entry.check.load(std::memory_order_relaxed);
+    if ((check ^ data) == hash && static_cast<int>(data & _depthMask) == depth) {
+      nodes = data >> _depthBits;
+      return true;
+    }
+  }
+  return false;
+}
+// -------------------------------------------------------------------------------------------------
+void PerftTable::store(std::uint64_t hash, int depth, std::uint64_t nodes)
+{
+  auto& bucket = mBuckets[hash & mMask];
+  auto  victim = &bucket.entries[0];
+  auto  lowest = _depthMask + 1;
+  for (auto& entry : bucket.entries) {
+    auto const data       = entry.data.load(std::memory_order_relaxed);
+    auto const check      = entry.check.load(std::memory_order_relaxed);
+    auto const entryDepth = static_cast<int>(data & _depthMask);
+    if ((check ^ data) == hash && entryDepth == depth) {
+      victim = &entry;
+      break;
+    }
+    if (entryDepth < lowest) {
+      victim = &entry;
+      lowest = entryDepth;
+    }
+  }
+
+  auto const data = nodes << _depthBits | static_cast<std::uint64_t>(depth);
+  victim->check.store(hash ^ data, std::memory_order_relaxed);
+  victim->data.store(data, std::memory_order_relaxed);
+}
+// -------------------------------------------------------------------------------------------------
+// Depth 0 is never stored, so an all zero entry matches nothing
+void PerftTable::clear()
+{
+  for (auto i = std::size_t{0}; i <= mMask; ++i) {
+    for (auto& entry : mBuckets[i].entries) {
+      entry.check.store(0, std::memory_order_relaxed);
+      entry.data.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+// -------------------------------------------------------------------------------------------------
+std::uint64_t perft(BoardState const& state, int depth, PerftOptions const& options)
+{
+  if (depth <= 0) return 1;
+
+  // One list per ply, so the search allocates up front and never again
+  auto lists = std::vector<MoveList>(static_cast<std::size_t>(depth));
+  auto visit = [&lists, &options](auto&             self,
+                                  BoardState const& position,
+                                  int               remaining) -> std::uint64_t {
+    if (remaining == 0) return 1;
+
+    // Subtrees of depth 1 cost less to count again than to look up
+    auto const table = remaining >= 2 ? options.table : nullptr;
+    auto const hash  = table ? position.getHash() : std::uint64_t{0};
+    auto       nodes = std::uint64_t{0};
+    if (table && table->probe(hash, remaining, nodes)) return nodes;
+
+    auto& moves = lists[static_cast<std::size_t>(remaining - 1)];
+    moves.clear();
+    generateMoves<GenType::Legal>(position, moves);
+    if (remaining == 1 && options.bulkCount) return moves.size();
+
+    for (auto const& move : moves) {
+      auto next = position;
+      next.makeMove(move);
+      nodes += self(self, next, remaining - 1);
+    }
+
+    if (table) table->store(hash, remaining, nodes);
+    return nodes;
+  };
+  return visit(visit, state, depth);
+}
+}  // namespace chessgen
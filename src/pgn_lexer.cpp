@@ -0,0 +1,292 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "chessgen/pgn_lexer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "chessgen/platform.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace chessgen
+{
+namespace
+{
+constexpr std::size_t _blockSize = 64;
+
+// Characters besides white space that end a token. '(' and ')' differ in the lowest bit only,
+// and so do '$' and '%', which lets the vector code test them in pairs
+bool isSpecial(char c)
+{
+  return c == '{' || c == '(' || c == ')' || c == ';' || c == '$' || c == '%';
+}
+
+bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+bool isResult(std::string_view token)
+{
+  return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+int countTrailingZeros(std::uint64_t bits)
+{
+  return intrin_ctz(bits) - 1;
+}
+
+// Bit i of spaces is set if p[i] is white space, bit i of stops if it is white space or special
+#if defined(__AVX2__)
+void classifyBlock(char const* p, std::uint64_t& spaces, std::uint64_t& stops)
+{
+  auto const above = _mm256_set1_epi8(' ' + 1);
+  auto const one   = _mm256_set1_epi8(1);
+
+  spaces = 0;
+  stops  = 0;
+  for (auto i = 0; i < 64; i += 32) {
+    auto const v     = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + i));
+    auto const s     = _mm256_cmpeq_epi8(_mm256_max_epu8(v, above), v);
+    auto const odd   = _mm256_or_si256(v, one);
+    auto const marks = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(odd, _mm256_set1_epi8(')')),
+                        _mm256_cmpeq_epi8(odd, _mm256_set1_epi8('%'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(';'))));
+
+    // s is all ones where the byte is above ' ', flip it
+    auto const spaceBits = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(s));
+    auto const markBits  = static_cast<std::uint32_t>(_mm256_movemask_epi8(marks));
+    spaces |= std::uint64_t{spaceBits} << i;
+    stops |= std::uint64_t{spaceBits | markBits} << i;
+  }
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+void classifyBlock(char const* p, std::uint64_t& spaces, std::uint64_t& stops)
+{
+  auto const above = _mm_set1_epi8(' ' + 1);
+  auto const one   = _mm_set1_epi8(1);
+
+  spaces = 0;
+  stops  = 0;
+  for (auto i = 0; i < 64; i += 16) {
+    auto const v     = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + i));
+    auto const s     = _mm_cmpeq_epi8(_mm_max_epu8(v, above), v);
+    auto const odd   = _mm_or_si128(v, one);
+    auto const marks = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(odd, _mm_set1_epi8(')')),
+                                                  _mm_cmpeq_epi8(odd, _mm_set1_epi8('%'))),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('{')),
+                                                  _mm_cmpeq_epi8(v, _mm_set1_epi8(';'))));
+
+    // s is all ones where the byte is above ' ', flip it
+    auto const spaceBits = ~static_cast<std::uint32_t>(_mm_movemask_epi8(s)) & 0xFFFFu;
+    auto const markBits  = static_cast<std::uint32_t>(_mm_movemask_epi8(marks));
+    spaces |= std::uint64_t{spaceBits} << i;
+    stops |= std::uint64_t{spaceBits | markBits} << i;
+  }
+}
+#else
+bool isSpace(char c)
+{
+  return static_cast<unsigned char>(c) <= ' ';
+}
+
+void classifyBlock(char const* p, std::uint64_t& spaces, std::uint64_t& stops)
+{
+  spaces = 0;
+  stops  = 0;
+  for (auto i = 0; i < 64; ++i) {
+    auto const space = isSpace(p[i]);
+    spaces |= std::uint64_t{space} << i;
+    stops |= std::uint64_t{space || isSpecial(p[i])} << i;
+  }
+}
+#endif
+}  // namespace
+// -------------------------------------------------------------------------------------------------
+MovetextLexer::MovetextLexer(std::string_view movetext) : mText(movetext)
+{
+}
+// -------------------------------------------------------------------------------------------------
+bool MovetextLexer::next(std::string_view& token)
+{
+  auto const size = mText.size();
+  while ((mPos = skipSpaces(mPos)) < size) {
+    auto const c = mText[mPos];
+    if (c == '{') {
+      skipComment();
+    } else if (c == ';') {
+      skipLine();
+    } else if (c == '%' && (mPos == 0 || mText[mPos - 1] == '\n')) {
+      skipLine();
+    } else if (c == '(') {
+      skipVariation();
+    } else if (isSpecial(c)) {
+      // Numeric annotation glyph, or a stray character
+      ++mPos;
+      while (c == '$' && mPos < size && isDigit(mText[mPos])) {
+        ++mPos;
+      }
+    } else {
+      auto const end  = findStop(mPos);
+      auto       word = mText.substr(mPos, end - mPos);
+      mPos            = end;
+
+      // Moves never start with a digit or '*', so only those need a closer look
+      if (!isDigit(c) && c != '*') {
+        token = word;
+        return true;
+      }
+      if (isResult(word)) {
+        mResult = word;
+        mPos    = size;
+        return false;
+      }
+
+      // Move numbers, possibly glued to the move ("1.e4"). Castling may be written with zeros,
+      // so digits only make a move number when a dot follows them
+      auto digits = std::size_t{0};
+      while (digits < word.size() && isDigit(word[digits])) {
+        ++digits;
+      }
+      if (digits > 0 && digits < word.size() && word[digits] == '.') {
+        while (digits < word.size() && word[digits] == '.') {
+          ++digits;
+        }
+        word.remove_prefix(digits);
+        if (word.empty()) continue;
+      }
+
+      token = word;
+      return true;
+    }
+  }
+  return false;
+}
+// -------------------------------------------------------------------------------------------------
+std::string_view MovetextLexer::getResult() const
+{
+  return mResult;
+}
+// -------------------------------------------------------------------------------------------------
+// Classifies the block holding pos, unless it already is. The last block of the text is copied
+// out and padded, and the bytes past the end count as stops but not as white space
+void MovetextLexer::classify(std::size_t pos)
+{
+  auto const block = pos & ~(_blockSize - 1);
+  if (block == mBlock) return;
+
+  mBlock               = block;
+  auto const remaining = mText.size() - block;
+  if (remaining >= _blockSize) {
+    classifyBlock(mText.data() + block, mSpaces, mStops);
+    return;
+  }
+
+  char tail[_blockSize] = {};
+  std::memcpy(tail, mText.data() + block, remaining);
+  classifyBlock(tail, mSpaces, mStops);
+
+  auto const valid = (std::uint64_t{1} << remaining) - 1;
+  mSpaces &= valid;
+  mStops |= ~valid;
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t MovetextLexer::skipSpaces(std::size_t pos)
+{
+  while (pos < mText.size()) {
+    classify(pos);
+    if (auto const others = ~mSpaces >> (pos - mBlock)) {
+      return std::min(pos + countTrailingZeros(others), mText.size());
+    }
+    pos = mBlock + _blockSize;
+  }
+  return mText.size();
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t MovetextLexer::findStop(std::size_t pos)
+{
+  while (pos < mText.size()) {
+    classify(pos);
+    if (auto const stops = mStops >> (pos - mBlock)) {
+      return std::min(pos + countTrailingZeros(stops), mText.size());
+    }
+    pos = mBlock + _blockSize;
+  }
+  return mText.size();
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t MovetextLexer::findSpecial(std::size_t pos)
+{
+  while (pos < mText.size()) {
+    classify(pos);
+    if (auto const specials = (mStops & ~mSpaces) >> (pos - mBlock)) {
+      return std::min(pos + countTrailingZeros(specials), mText.size());
+    }
+    pos = mBlock + _blockSize;
+  }
+  return mText.size();
+}
+// -------------------------------------------------------------------------------------------------
+void MovetextLexer::skipLine()
+{
+  auto const end = mText.find('\n', mPos);
+  mPos           = end == std::string_view::npos ? mText.size() : end + 1;
+}
+// -------------------------------------------------------------------------------------------------
+void MovetextLexer::skipComment()
+{
+  auto const end = mText.find('}', mPos);
+  mPos           = end == std::string_view::npos ? mText.size() : end + 1;
+}
+// -------------------------------------------------------------------------------------------------
+// Variations nest, and may hold comments with unbalanced parentheses. Only the special
+// characters matter in here, so jump from one to the next
+void MovetextLexer::skipVariation()
+{
+  auto depth = 0;
+  while ((mPos = findSpecial(mPos)) < mText.size()) {
+    auto const c = mText[mPos];
+    if (c == '{') {
+      skipComment();
+      continue;
+    }
+    if (c == ';') {
+      skipLine();
+      continue;
+    }
+
+    ++mPos;
+    if (c == '(') {
+      ++depth;
+    } else if (c == ')' && --depth == 0) {
+      return;
+    }
+  }
+}
+}  // namespace chessgen
@@ -0,0 +1,444 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "chessgen/pgn_reader.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <sstream>
+#endif
+
+#include "chessgen/pgn_lexer.hpp"
+#include "chessgen/san.hpp"
+
+namespace chessgen
+{
+namespace
+{
+// A run of consecutive games, in input order, handed to a worker at once. The splitter already
+// found where each game ends, so the workers do not scan for it again
+struct Batch {
+  std::size_t              begin;
+  std::size_t              firstIndex;
+  std::vector<std::size_t> ends;
+};
+
+// Bounded so that the splitter stays close to the workers and the pages it touched are still
+// cached when they get replayed
+class BatchQueue
+{
+public:
+  explicit BatchQueue(std::size_t capacity) : mCapacity(capacity)
+  {
+  }
+
+  // Returns false if a worker failed and no more batches are wanted
+  bool push(Batch&& batch)
+  {
+    auto lock = std::unique_lock<std::mutex>{mMutex};
+    mNotFull.wait(lock, [this] { return mError || mBatches.size() < mCapacity; });
+    if (mError) return false;
+
+    mBatches.push_back(std::move(batch));
+    mNotEmpty.notify_one();
+    return true;
+  }
+
+  // Returns false once the queue is closed and drained, or a worker failed
+  bool pop(Batch& batch)
+  {
+    auto lock = std::unique_lock<std::mutex>{mMutex};
+    mNotEmpty.wait(lock, [this] { return mError || mClosed || !mBatches.empty(); });
+    if (mError || mBatches.empty()) return false;
+
+    batch = std::move(mBatches.front());
+    mBatches.pop_front();
+    mNotFull.notify_one();
+    return true;
+  }
+
+  void close()
+  {
+    auto const lock = std::lock_guard<std::mutex>{mMutex};
+    mClosed         = true;
+    mNotEmpty.notify_all();
+  }
+
+  void fail(std::exception_ptr error)
+  {
+    auto const lock = std::lock_guard<std::mutex>{mMutex};
+    if (!mError) {
+      mError = std::move(error);
+    }
+    mNotEmpty.notify_all();
+    mNotFull.notify_all();
+  }
+
+  std::exception_ptr getError() const
+  {
+    auto const lock = std::lock_guard<std::mutex>{mMutex};
+    return mError;
+  }
+
+private:
+  mutable std::mutex      mMutex;
+  std::condition_variable mNotEmpty;
+  std::condition_variable mNotFull;
+  std::deque<Batch>       mBatches;
+  std::size_t             mCapacity;
+  bool                    mClosed{false};
+  std::exception_ptr      mError;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+class MappedFile
+{
+public:
+  explicit MappedFile(std::string const& path)
+  {
+    auto const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Cannot open " + path);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Cannot open " + path);
+    }
+
+    mSize = static_cast<std::size_t>(info.st_size);
+    if (mSize > 0) {
+      mData = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+
+    if (mData == MAP_FAILED) {
+      mData = nullptr;
+      throw std::runtime_error("Cannot map " + path);
+    }
+
+    // The splitter and the workers both go through the file front to back
+    if (mData) {
+      ::madvise(mData, mSize, MADV_SEQUENTIAL);
+    }
+  }
+  ~MappedFile()
+  {
+    if (mData) {
+      ::munmap(mData, mSize);
+    }
+  }
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  std::string_view getText() const
+  {
+    return {static_cast<char const*>(mData), mSize};
+  }
+
+private:
+  void*       mData{nullptr};
+  std::size_t mSize{0};
+};
+#else
+// No mmap, read the whole file instead
+class MappedFile
+{
+public:
+  explicit MappedFile(std::string const& path)
+  {
+    auto file = std::ifstream{path, std::ios::binary};
+    if (!file) {
+      throw std::runtime_error("Cannot open " + path);
+    }
+
+    auto ss = std::ostringstream{};
+    ss << file.rdbuf();
+    mData = ss.str();
+  }
+
+  std::string_view getText() const
+  {
+    return mData;
+  }
+
+private:
+  std::string mData;
+};
+#endif
+
+bool isSpace(char c)
+{
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+std::size_t skipSpaces(std::string_view text, std::size_t pos)
+{
+  while (pos < text.size() && isSpace(text[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+// Where the game starting at begin ends: at the first tag line that follows some movetext.
+// Comments spanning lines that start with '[' are not expected and would split the game
+std::size_t findGameEnd(std::string_view text, std::size_t begin)
+{
+  auto seenMovetext = false;
+  auto pos          = begin;
+  while (pos < text.size()) {
+    auto first = pos;
+    while (first < text.size() && text[first] != '\n' && isSpace(text[first])) {
+      ++first;
+    }
+
+    auto const c = first < text.size() ? text[first] : '\n';
+    if (c == '[' && seenMovetext) {
+      return pos;
+    }
+    if (c != '[' && c != '%' && c != '\n') {
+      seenMovetext = true;
+    }
+
+    auto const eol = text.find('\n', pos);
+    pos            = eol == std::string_view::npos ? text.size() : eol + 1;
+  }
+  return text.size();
+}
+
+// [Name "Value"]
+bool parseTag(std::string_view line, PgnTag& tag)
+{
+  while (!line.empty() && isSpace(line.back())) {
+    line.remove_suffix(1);
+  }
+  if (line.size() < 2 || line.front() != '[' || line.back() != ']') return false;
+  line = line.substr(1, line.size() - 2);
+
+  auto const space = line.find(' ');
+  auto const open  = line.find('"');
+  auto const close = line.rfind('"');
+  if (space == 0 || space == std::string_view::npos || open < space || close == open) {
+    return false;
+  }
+
+  tag.name  = line.substr(0, space);
+  tag.value = line.substr(open + 1, close - open - 1);
+  return true;
+}
+
+// Values with escapes are copied to game.tagText, reserved up front so that the views already
+// handed out stay valid while it fills
+void unescapeTags(PgnGame& game)
+{
+  auto size = std::size_t{0};
+  for (auto const& tag : game.tags) {
+    if (tag.value.find('\\') != std::string_view::npos) size += tag.value.size();
+  }
+  game.tagText.clear();
+  game.tagText.reserve(size);
+
+  for (auto& tag : game.tags) {
+    if (tag.value.find('\\') == std::string_view::npos) continue;
+
+    auto const begin = game.tagText.size();
+    for (auto i = std::size_t{0}; i < tag.value.size(); ++i) {
+      if (tag.value[i] == '\\' && i + 1 < tag.value.size()) ++i;
+      game.tagText.push_back(tag.value[i]);
+    }
+    tag.value = std::string_view{game.tagText}.substr(begin);
+  }
+}
+
+void replayGame(std::string_view   text,
+                BoardState const&  initial,
+                PgnGame&           game,
+                SingleThreadBoard& board)
+{
+  game.text = text;
+  game.tags.clear();
+  game.moves.clear();
+  game.result     = {};
+  game.error      = PgnError::None;
+  game.errorToken = {};
+
+  auto const fail = [&](PgnError error, std::string_view token) {
+    game.error      = error;
+    game.errorToken = token;
+  };
+
+  // Tag pairs, one per line
+  auto pos = skipSpaces(text, 0);
+  while (pos < text.size() && text[pos] == '[') {
+    auto const eol  = text.find('\n', pos);
+    auto const line = text.substr(pos, eol == std::string_view::npos ? eol : eol - pos);
+    auto       tag  = PgnTag{};
+    if (!parseTag(line, tag)) {
+      board.reset(initial);
+      return fail(PgnError::Tag, line);
+    }
+
+    game.tags.push_back(tag);
+    pos = skipSpaces(text, eol == std::string_view::npos ? text.size() : eol + 1);
+  }
+  unescapeTags(game);
+
+  auto state = initial;
+  if (auto const fen = game.getTag("FEN"); !fen.empty()) {
+    if (BoardState::parseFen(fen, state) != FenError::None) {
+      board.reset(initial);
+      return fail(PgnError::Fen, fen);
+    }
+  }
+  board.reset(state);
+
+  auto lexer = MovetextLexer{text.substr(pos)};
+  auto token = std::string_view{};
+  while (lexer.next(token)) {
+    auto san = SANMove{};
+    if (SANMove::tryParse(token, san) != SanError::None || !board.makeMove(san)) {
+      return fail(PgnError::Move, token);
+    }
+    game.moves.push_back(board.getMoveAt(board.getHistorySize() - 2));
+  }
+  game.result = lexer.getResult();
+}
+}  // namespace
+// -------------------------------------------------------------------------------------------------
+char const* to_string(PgnError error)
+{
+  switch (error) {
+    case PgnError::None:
+      return "No error";
+    case PgnError::Tag:
+      return "Malformed tag pair";
+    case PgnError::Fen:
+      return "Invalid FEN tag";
+    case PgnError::Move:
+      return "Malformed or illegal move";
+  }
+  return "Unknown error";
+}
+// -------------------------------------------------------------------------------------------------
+std::string_view PgnGame::getTag(std::string_view name) const
+{
+  for (auto const& tag : tags) {
+    if (tag.name == name) {
+      return tag.value;
+    }
+  }
+  return {};
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t readPgn(std::string_view text, PgnCallback const& callback, PgnReadOptions const& options)
+{
+  auto const threads    = std::max(1u, options.threads ? options.threads
+                                                       : std::thread::hardware_concurrency());
+  auto const batchGames = std::max<std::size_t>(1, options.batchGames);
+  auto const initial    = SingleThreadBoard{}.getState();
+
+  auto queue = BatchQueue{threads * 4};
+
+  auto work = [&] {
+    auto board = SingleThreadBoard{};
+    auto game  = PgnGame{};
+    auto batch = Batch{};
+    try {
+      while (queue.pop(batch)) {
+        auto pos = batch.begin;
+        for (auto i = std::size_t{0}; i < batch.ends.size(); ++i) {
+          auto const end = batch.ends[i];
+
+          game.index = batch.firstIndex + i;
+          replayGame(text.substr(pos, end - pos), initial, game, board);
+          callback(game, board);
+
+          pos = skipSpaces(text, end);
+        }
+      }
+    } catch (...) {
+      queue.fail(std::current_exception());
+    }
+  };
+
+  // Whatever goes wrong here, from starting a thread on, fails the queue like a worker would, so
+  // the threads already running stop and are joined before the error is rethrown
+  auto workers = std::vector<std::thread>{};
+  auto games   = std::size_t{0};
+  try {
+    workers.reserve(threads);
+    for (auto i = 0u; i < threads; ++i) {
+      workers.emplace_back(work);
+    }
+
+    // Split the text into batches of games while the workers replay them
+    auto pos = skipSpaces(text, 0);
+    while (pos < text.size()) {
+      auto batch = Batch{pos, games, {}};
+      batch.ends.reserve(batchGames);
+      while (batch.ends.size() < batchGames && pos < text.size()) {
+        batch.ends.push_back(findGameEnd(text, pos));
+        pos = skipSpaces(text, batch.ends.back());
+      }
+
+      auto const count = batch.ends.size();
+      if (!queue.push(std::move(batch))) break;
+      games += count;
+    }
+  } catch (...) {
+    queue.fail(std::current_exception());
+  }
+  queue.close();
+
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  if (auto const error = queue.getError()) {
+    std::rethrow_exception(error);
+  }
+  return games;
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t readPgnFile(std::string const&    path,
+                        PgnCallback const&    callback,
+                        PgnReadOptions const& options)
+{
+  auto const file = MappedFile{path};
+  return readPgn(file.getText(), callback, options);
+}
+}  // namespace chessgen
@@ -0,0 +1,183 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "chessgen/pgn_writer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <ostream>
+
+#include "chessgen/san.hpp"
+
+namespace chessgen
+{
+namespace
+{
+constexpr std::string_view _initialFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+bool hasTag(std::vector<PgnTag> const& tags, std::string_view name)
+{
+  for (auto const& tag : tags) {
+    if (tag.name == name) return true;
+  }
+  return false;
+}
+
+// Collects movetext tokens into lines no longer than the width, unless a token is longer on its
+// own, and hands each finished line to the sink
+template <typename Sink>
+class LineWriter
+{
+public:
+  LineWriter(Sink& sink, std::size_t width) : mSink(sink), mWidth(width)
+  {
+  }
+
+  void write(std::string_view token)
+  {
+    if (!mLine.empty()) {
+      if (mLine.size() + 1 + token.size() > mWidth) {
+        endLine();
+      } else {
+        mLine += ' ';
+      }
+    }
+    mLine += token;
+  }
+  void endLine()
+  {
+    mLine += '\n';
+    mSink(std::string_view{mLine});
+    mLine.clear();
+  }
+
+private:
+  Sink&       mSink;
+  std::size_t mWidth;
+  std::string mLine;
+};
+
+template <typename Sink>
+void writeTag(Sink& sink, std::string_view name, std::string_view value)
+{
+  sink(std::string_view{"["});
+  sink(name);
+  sink(std::string_view{" \""});
+  // Quotes and backslashes inside the value are escaped with a backslash
+  for (auto pos = value.find_first_of("\"\\"); pos != std::string_view::npos;
+       pos      = value.find_first_of("\"\\")) {
+    sink(value.substr(0, pos));
+    sink(value[pos] == '"' ? std::string_view{"\\\""} : std::string_view{"\\\\"});
+    value.remove_prefix(pos + 1);
+  }
+  sink(value);
+  sink(std::string_view{"\"]\n"});
+}
+
+template <typename Sink>
+void writeGame(GameHistory const&         history,
+               std::vector<PgnTag> const& tags,
+               std::string_view           result,
+               PgnWriteOptions const&     options,
+               Sink&                      sink)
+{
+  if (result.empty()) result = "*";
+
+  auto const initial = history.getState(0);
+  char       fen[BoardState::FenBufferSize];
+  auto const fenLength = initial.writeFen(fen, sizeof(fen));
+  auto const fenView   = std::string_view{fen, fenLength};
+
+  for (auto const& tag : tags) {
+    writeTag(sink, tag.name, tag.value);
+  }
+  if (!hasTag(tags, "Result")) {
+    writeTag(sink, "Result", result);
+  }
+  if (fenView != _initialFen && !hasTag(tags, "FEN")) {
+    writeTag(sink, "SetUp", "1");
+    writeTag(sink, "FEN", fenView);
+  }
+  sink(std::string_view{"\n"});
+
+  auto const moves = history.getMoves();
+  auto       sans  = std::vector<SanText>(moves.size());
+  initial.getSanForLine(moves.data(), moves.size(), sans.data());
+
+  auto lines  = LineWriter<Sink>{sink, options.lineWidth};
+  auto number = initial.getFullMove();
+  auto turn   = initial.getActivePlayer();
+  for (auto i = std::size_t{0}; i < sans.size(); ++i) {
+    if (turn == ColorWhite || i == 0) {
+      char       buffer[16];
+      auto const end = std::to_chars(buffer, buffer + sizeof(buffer) - 3, number).ptr;
+      auto const dots = turn == ColorWhite ? 1 : 3;
+      std::fill(end, end + dots, '.');
+      lines.write(std::string_view{buffer, static_cast<std::size_t>(end + dots - buffer)});
+    }
+    lines.write(sans[i].view());
+
+    if (turn == ColorBlack) ++number;
+    turn = ~turn;
+  }
+  lines.write(result);
+  lines.endLine();
+  sink(std::string_view{"\n"});
+}
+}  // namespace
+// -------------------------------------------------------------------------------------------------
+char const* getPgnResult(GameOverReason reason, Color sideToMove)
+{
+  switch (reason) {
+    case GameOverReason::Mate:
+      return sideToMove == ColorWhite ? "0-1" : "1-0";
+    case GameOverReason::Threefold:
+    case GameOverReason::Stalemate:
+    case GameOverReason::InsuffMaterial:
+      return "1/2-1/2";
+    case GameOverReason::OnGoing:
+    default:
+      return "*";
+  }
+}
+// -------------------------------------------------------------------------------------------------
+void writePgn(GameHistory const&         history,
+              std::vector<PgnTag> const& tags,
+              std::string_view           result,
+              std::string&               out,
+              PgnWriteOptions const&     options)
+{
+  auto sink = [&out](std::string_view text) { out.append(text.data(), text.size()); };
+  writeGame(history, tags, result, options, sink);
+}
+// -------------------------------------------------------------------------------------------------
+void writePgn(GameHistory const&         history,
+              std::vector<PgnTag> const& tags,
+              std::string_view           result,
+              std::ostream&              out,
+              PgnWriteOptions const&     options)
+{
+  auto sink = [&out](std::string_view text) {
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+  };
+  writeGame(history, tags, result, options, sink);
+}
+}  // namespace chessgen
@@ -0,0 +1,435 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "chessgen/position_batch.hpp"
+
+#include "chessgen/helpers.hpp"
+#include "chessgen/movegen.hpp"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace chessgen
+{
+namespace detail
+{
+// Raw column pointers of a batch, so the kernels do not need access to PositionBatch internals
+struct BatchColumns {
+  std::uint64_t const* pieces[ColorCount][PieceCount];
+  std::uint64_t const* allPieces[ColorCount];
+  std::uint64_t const* whiteToMove;
+};
+}  // namespace detail
+
+namespace
+{
+using detail::BatchColumns;
+
+// -------------------------------------------------------------------------------------------------
+// Lane types. The kernels below are written once against this interface and instantiated for
+// plain 64 bit integers (one position at a time) and for the SIMD registers (several positions
+// per instruction, one per 64 bit lane)
+// -------------------------------------------------------------------------------------------------
+struct ScalarLanes {
+  using Vec = std::uint64_t;
+
+  static constexpr std::size_t Width = 1;
+
+  // clang-format off
+  static Vec  load(std::uint64_t const* p) { return *p; }
+  static void store(std::uint64_t* p, Vec v) { *p = v; }
+  static Vec  set1(std::uint64_t x) { return x; }
+  static Vec  bitAnd(Vec a, Vec b) { return a & b; }
+  static Vec  bitOr(Vec a, Vec b) { return a | b; }
+  static Vec  andNot(Vec a, Vec b) { return ~a & b; }
+  template <int N> static Vec shl(Vec a) { return a << N; }
+  template <int N> static Vec shr(Vec a) { return a >> N; }
+  // clang-format on
+};
+#if defined(__AVX2__)
+struct Avx2Lanes {
+  using Vec = __m256i;
+
+  static constexpr std::size_t Width = 4;
+
+  // clang-format off
+  static Vec  load(std::uint64_t const* p) { return _mm256_loadu_si256(reinterpret_cast<Vec const*>(p)); }
+  static void store(std::uint64_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<Vec*>(p), v); }
+  static Vec  set1(std::uint64_t x) { return _mm256_set1_epi64x(static_cast<long long>(x)); }
+  static Vec  bitAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+  static Vec  bitOr(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+  static Vec  andNot(Vec a, Vec b) { return _mm256_andnot_si256(a, b); }
+  template <int N> static Vec shl(Vec a) { return _mm256_slli_epi64(a, N); }
+  template <int N> static Vec shr(Vec a) { return _mm256_srli_epi64(a, N); }
+  // clang-format on
+};
+#endif
+#if defined(__AVX512F__)
+struct Avx512Lanes {
+  using Vec = __m512i;
+
+  static constexpr std::size_t Width = 8;
+
+  // clang-format off
+  static Vec  load(std::uint64_t const* p) { return _mm512_loadu_si512(p); }
+  static void store(std::uint64_t* p, Vec v) { _mm512_storeu_si512(p, v); }
+  static Vec  set1(std::uint64_t x) { return _mm512_set1_epi64(static_cast<long long>(x)); }
+  static Vec  bitAnd(Vec a, Vec b) { return _mm512_and_si512(a, b); }
+  static Vec  bitOr(Vec a, Vec b) { return _mm512_or_si512(a, b); }
+  // Masked forms: GCC's unmasked ones merge into _mm512_undefined_epi32 and warn when inlined
+  static Vec  andNot(Vec a, Vec b) { return _mm512_maskz_andnot_epi64(0xFF, a, b); }
+  template <int N> static Vec shl(Vec a) { return _mm512_maskz_slli_epi64(0xFF, a, N); }
+  template <int N> static Vec shr(Vec a) { return _mm512_maskz_srli_epi64(0xFF, a, N); }
+  // clang-format on
+};
+#endif
+
+#if defined(__AVX512F__)
+using SimdLanes = Avx512Lanes;
+#elif defined(__AVX2__)
+using SimdLanes = Avx2Lanes;
+#else
+using SimdLanes = ScalarLanes;
+#endif
+
+// -------------------------------------------------------------------------------------------------
+template <typename L, int Delta>
+typename L::Vec shiftBy(typename L::Vec v)
+{
+  if constexpr (Delta > 0)
+    return L::template shl<Delta>(v);
+  else
+    return L::template shr<-Delta>(v);
+}
+// -------------------------------------------------------------------------------------------------
+// Lane-wise version of Bitboard::occludedFill followed by shiftTowards
+template <typename L, Direction D>
+typename L::Vec slide(typename L::Vec sliders, typename L::Vec empty)
+{
+  constexpr auto delta = detail::directionDelta(D);
+
+  auto const wrap = L::set1(detail::directionWrapMask(D).getBits());
+  auto       gen  = sliders;
+  auto       pro  = L::bitAnd(empty, wrap);
+
+  gen = L::bitOr(gen, L::bitAnd(pro, shiftBy<L, delta>(gen)));
+  pro = L::bitAnd(pro, shiftBy<L, delta>(pro));
+  gen = L::bitOr(gen, L::bitAnd(pro, shiftBy<L, 2 * delta>(gen)));
+  pro = L::bitAnd(pro, shiftBy<L, 2 * delta>(pro));
+  gen = L::bitOr(gen, L::bitAnd(pro, shiftBy<L, 4 * delta>(gen)));
+
+  return L::bitAnd(shiftBy<L, delta>(gen), wrap);
+}
+// -------------------------------------------------------------------------------------------------
+template <typename L>
+typename L::Vec rookAttacks(typename L::Vec rooks, typename L::Vec empty)
+{
+  return L::bitOr(L::bitOr(slide<L, Direction::North>(rooks, empty),
+                           slide<L, Direction::South>(rooks, empty)),
+                  L::bitOr(slide<L, Direction::East>(rooks, empty),
+                           slide<L, Direction::West>(rooks, empty)));
+}
+// -------------------------------------------------------------------------------------------------
+template <typename L>
+typename L::Vec bishopAttacks(typename L::Vec bishops, typename L::Vec empty)
+{
+  return L::bitOr(L::bitOr(slide<L, Direction::NorthEast>(bishops, empty),
+                           slide<L, Direction::NorthWest>(bishops, empty)),
+                  L::bitOr(slide<L, Direction::SouthEast>(bishops, empty),
+                           slide<L, Direction::SouthWest>(bishops, empty)));
+}
+// -------------------------------------------------------------------------------------------------
+template <typename L, Color C>
+typename L::Vec pawnAttacks(typename L::Vec pawns)
+{
+  auto const notFileA = L::set1(~Bitboards::FileA.getBits());
+  auto const notFileH = L::set1(~Bitboards::FileH.getBits());
+
+  if constexpr (C == ColorWhite)
+    return L::bitOr(L::bitAnd(L::template shl<9>(pawns), notFileA),
+                    L::bitAnd(L::template shl<7>(pawns), notFileH));
+  else
+    return L::bitOr(L::bitAnd(L::template shr<7>(pawns), notFileA),
+                    L::bitAnd(L::template shr<9>(pawns), notFileH));
+}
+// -------------------------------------------------------------------------------------------------
+template <typename L>
+typename L::Vec knightAttacks(typename L::Vec knights)
+{
+  auto const notA  = L::set1(~Bitboards::FileA.getBits());
+  auto const notH  = L::set1(~Bitboards::FileH.getBits());
+  auto const notAB = L::set1(~(Bitboards::FileA | Bitboards::FileB).getBits());
+  auto const notGH = L::set1(~(Bitboards::FileG | Bitboards::FileH).getBits());
+
+  auto const k  = knights;
+  auto const l1 = L::bitAnd(L::bitOr(L::template shl<15>(k), L::template shr<17>(k)), notH);
+  auto const r1 = L::bitAnd(L::bitOr(L::template shr<15>(k), L::template shl<17>(k)), notA);
+  auto const l2 = L::bitAnd(L::bitOr(L::template shl<6>(k), L::template shr<10>(k)), notGH);
+  auto const r2 = L::bitAnd(L::bitOr(L::template shr<6>(k), L::template shl<10>(k)), notAB);
+
+  return L::bitOr(L::bitOr(l1, r1), L::bitOr(l2, r2));
+}
+// -------------------------------------------------------------------------------------------------
+template <typename L>
+typename L::Vec kingAttacks(typename L::Vec kings)
+{
+  auto const notFileA = L::set1(~Bitboards::FileA.getBits());
+  auto const notFileH = L::set1(~Bitboards::FileH.getBits());
+  auto const sides    = L::bitOr(L::bitAnd(L::template shl<1>(kings), notFileA),
+                                 L::bitAnd(L::template shr<1>(kings), notFileH));
+  auto const row      = L::bitOr(kings, sides);
+
+  return L::bitOr(sides, L::bitOr(L::template shl<8>(row), L::template shr<8>(row)));
+}
+// -------------------------------------------------------------------------------------------------
+template <typename L, Color C>
+typename L::Vec attackMap(BatchColumns const& c, std::size_t i)
+{
+  auto const load = [&](Color color, Piece piece) { return L::load(c.pieces[color][piece] + i); };
+
+  // Same as BoardState: the enemy king does not block our sliders
+  auto const all      = L::bitOr(L::load(c.allPieces[C] + i), L::load(c.allPieces[~C] + i));
+  auto const occupied = L::andNot(load(~C, PieceKing), all);
+  auto const empty    = L::andNot(occupied, L::set1(~0ULL));
+  auto const queens   = load(C, PieceQueen);
+
+  auto const leapers = L::bitOr(pawnAttacks<L, C>(load(C, PiecePawn)),
+                                L::bitOr(knightAttacks<L>(load(C, PieceKnight)),
+                                         kingAttacks<L>(load(C, PieceKing))));
+  auto const sliders = L::bitOr(rookAttacks<L>(L::bitOr(load(C, PieceRook), queens), empty),
+                                bishopAttacks<L>(L::bitOr(load(C, PieceBishop), queens), empty));
+
+  return L::bitOr(leapers, sliders);
+}
+// -------------------------------------------------------------------------------------------------
+template <typename L>
+typename L::Vec checkers(BatchColumns const& c, std::size_t i)
+{
+  auto const white  = L::load(c.whiteToMove + i);
+  auto const select = [&](std::uint64_t const* const* byColor, Piece piece, bool ours) {
+    auto const w = L::load(byColor[ColorWhite * PieceCount + piece] + i);
+    auto const b = L::load(byColor[ColorBlack * PieceCount + piece] + i);
+    return ours ? L::bitOr(L::bitAnd(white, w), L::andNot(white, b))
+                : L::bitOr(L::bitAnd(white, b), L::andNot(white, w));
+  };
+  auto const pieces = &c.pieces[0][0];
+
+  auto const king    = select(pieces, PieceKing, true);
+  auto const queens  = select(pieces, PieceQueen, false);
+  auto const rooks   = L::bitOr(select(pieces, PieceRook, false), queens);
+  auto const bishops = L::bitOr(select(pieces, PieceBishop, false), queens);
+  auto const empty   = L::andNot(L::bitOr(L::load(c.allPieces[ColorWhite] + i),
+                                        L::load(c.allPieces[ColorBlack] + i)),
+                               L::set1(~0ULL));
+
+  // The enemy pawns attacking our king sit where our own pawn would attack from the king square
+  auto const pawnSquares = L::bitOr(L::bitAnd(white, pawnAttacks<L, ColorWhite>(king)),
+                                    L::andNot(white, pawnAttacks<L, ColorBlack>(king)));
+
+  auto const pawns   = select(pieces, PiecePawn, false);
+  auto const knights = select(pieces, PieceKnight, false);
+  auto const leapers = L::bitOr(L::bitAnd(pawnSquares, pawns),
+                                L::bitAnd(knightAttacks<L>(king), knights));
+  auto const sliders = L::bitOr(L::bitAnd(rookAttacks<L>(king, empty), rooks),
+                                L::bitAnd(bishopAttacks<L>(king, empty), bishops));
+
+  return L::bitOr(leapers, sliders);
+}
+// -------------------------------------------------------------------------------------------------
+// Runs kernel(lanes, index) over [0, count), SimdLanes::Width positions at a time and one by one
+// for whatever is left at the end
+template <typename Kernel>
+void forEachBlock(std::size_t count, Kernel kernel)
+{
+  auto i = std::size_t{0};
+  if constexpr (SimdLanes::Width > 1) {
+    for (; i + SimdLanes::Width <= count; i += SimdLanes::Width) {
+      kernel(SimdLanes{}, i);
+    }
+  }
+  for (; i < count; ++i) {
+    kernel(ScalarLanes{}, i);
+  }
+}
+}  // namespace
+
+// -------------------------------------------------------------------------------------------------
+PositionBatch::PositionBatch(std::size_t capacity)
+{
+  reserve(capacity);
+}
+// -------------------------------------------------------------------------------------------------
+void PositionBatch::reserve(std::size_t capacity)
+{
+  for (auto color : {ColorWhite, ColorBlack}) {
+    for (auto& pieces : mPieces[color]) {
+      pieces.reserve(capacity);
+    }
+    mAllPieces[color].reserve(capacity);
+  }
+  mEnPassant.reserve(capacity);
+  mWhiteToMove.reserve(capacity);
+  mCastleRights.reserve(capacity);
+  mHalfMoves.reserve(capacity);
+  mFullMove.reserve(capacity);
+}
+// -------------------------------------------------------------------------------------------------
+void PositionBatch::clear()
+{
+  for (auto color : {ColorWhite, ColorBlack}) {
+    for (auto& pieces : mPieces[color]) {
+      pieces.clear();
+    }
+    mAllPieces[color].clear();
+  }
+  mEnPassant.clear();
+  mWhiteToMove.clear();
+  mCastleRights.clear();
+  mHalfMoves.clear();
+  mFullMove.clear();
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t PositionBatch::size() const
+{
+  return mEnPassant.size();
+}
+// -------------------------------------------------------------------------------------------------
+bool PositionBatch::empty() const
+{
+  return mEnPassant.empty();
+}
+// -------------------------------------------------------------------------------------------------
+void PositionBatch::push_back(BoardState const& state)
+{
+  for (auto color : {ColorWhite, ColorBlack}) {
+    for (auto piece = 0; piece < PieceCount; ++piece) {
+      mPieces[color][piece].push_back(state.getPieces(color, Piece(piece)).getBits());
+    }
+    mAllPieces[color].push_back(state.getAllPieces(color).getBits());
+  }
+  mEnPassant.push_back(state.getEnPassant().getBits());
+  mWhiteToMove.push_back(state.getActivePlayer() == ColorWhite ? ~0ULL : 0ULL);
+  mCastleRights.push_back(static_cast<std::uint8_t>(
+      static_cast<int>(state.getCastlingRights(ColorWhite)) |
+      static_cast<int>(state.getCastlingRights(ColorBlack)) << 2));
+  mHalfMoves.push_back(state.getHalfMoves());
+  mFullMove.push_back(state.getFullMove());
+}
+// -------------------------------------------------------------------------------------------------
+BoardState PositionBatch::getState(std::size_t index) const
+{
+  CHESSGEN_ASSERT(index < size());
+
+  BoardState state;
+
+  for (auto color : {ColorWhite, ColorBlack}) {
+    for (auto piece = 0; piece < PieceCount; ++piece) {
+      state.mPieces[color][piece] = Bitboard{mPieces[color][piece][index]};
+    }
+  }
+  state.mEnPassant                = Bitboard{mEnPassant[index]};
+  state.mTurn                     = getActivePlayer(index);
+  state.mCastleRights[ColorWhite] = CastleSide(mCastleRights[index] & 3);
+  state.mCastleRights[ColorBlack] = CastleSide(mCastleRights[index] >> 2);
+  state.mHalfMoves                = mHalfMoves[index];
+  state.mFullMove                 = mFullMove[index];
+
+  state.updateNonPieceBitboards();
+  state.updateAttackMaps();
+
+  return state;
+}
+// -------------------------------------------------------------------------------------------------
+Bitboard PositionBatch::getPieces(std::size_t index, Color color, Piece type) const
+{
+  return Bitboard{mPieces[color][type][index]};
+}
+// -------------------------------------------------------------------------------------------------
+Color PositionBatch::getActivePlayer(std::size_t index) const
+{
+  return mWhiteToMove[index] ? ColorWhite : ColorBlack;
+}
+// -------------------------------------------------------------------------------------------------
+BatchColumns PositionBatch::getColumns() const
+{
+  auto columns = BatchColumns{};
+  for (auto color : {ColorWhite, ColorBlack}) {
+    for (auto piece = 0; piece < PieceCount; ++piece) {
+      columns.pieces[color][piece] = mPieces[color][piece].data();
+    }
+    columns.allPieces[color] = mAllPieces[color].data();
+  }
+  columns.whiteToMove = mWhiteToMove.data();
+  return columns;
+}
+// -------------------------------------------------------------------------------------------------
+void PositionBatch::computeAttackMaps(Color color, Bitboard* out) const
+{
+  static_assert(sizeof(Bitboard) == sizeof(std::uint64_t));
+
+  auto const columns = getColumns();
+  auto const result  = reinterpret_cast<std::uint64_t*>(out);
+
+  forEachBlock(size(), [&](auto lanes, std::size_t i) {
+    using L = decltype(lanes);
+    if (color == ColorWhite)
+      L::store(result + i, attackMap<L, ColorWhite>(columns, i));
+    else
+      L::store(result + i, attackMap<L, ColorBlack>(columns, i));
+  });
+}
+// -------------------------------------------------------------------------------------------------
+void PositionBatch::computeCheckers(Bitboard* out) const
+{
+  auto const columns = getColumns();
+  auto const result  = reinterpret_cast<std::uint64_t*>(out);
+
+  forEachBlock(size(), [&](auto lanes, std::size_t i) {
+    using L = decltype(lanes);
+    L::store(result + i, checkers<L>(columns, i));
+  });
+}
+// -------------------------------------------------------------------------------------------------
+void PositionBatch::computeInCheck(std::uint8_t* out) const
+{
+  auto const columns = getColumns();
+
+  forEachBlock(size(), [&](auto lanes, std::size_t i) {
+    using L = decltype(lanes);
+
+    std::uint64_t block[L::Width];
+    L::store(block, checkers<L>(columns, i));
+    for (auto lane = std::size_t{0}; lane < L::Width; ++lane) {
+      out[i + lane] = block[lane] != 0;
+    }
+  });
+}
+// -------------------------------------------------------------------------------------------------
+void PositionBatch::countLegalMoves(int* out) const
+{
+  // Move generation is inherently per position: pins, en passant and castling all branch on
+  // the position itself. This reuses the regular generator one position at a time
+  for (auto i = std::size_t{0}; i < size(); ++i) {
+    out[i] = static_cast<int>(generateMoves<GenType::Legal>(getState(i)).size());
+  }
+}
+}  // namespace chessgen
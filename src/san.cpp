@@ -1,6 +1,9 @@
 #include <chessgen/san.hpp>
 #include <chessgen/helpers.hpp>
 
+#include <cctype>
+#include <stdexcept>
+
 namespace chessgen
 {
 SANMove::SANMove(File fromFile, Rank fromRank, Square toSquare, Piece promotedTo)
@@ -30,104 +33,192 @@ SANMove::SANMove(CastleSide castling)
       mCastling(castling)
 {
 }
-SANMove SANMove::parse(std::string_view move)
+char const* to_string(SanError error)
 {
-  using namespace std::literals;
-
-  auto sanGetPieceType = [](char c) {
-    c = std::tolower(c);
-    switch (c) {
-      // clang-format off
-      case 'q': return PieceQueen;
-      case 'r': return PieceRook; 
-      case 'n': return PieceKnight; 
-      case 'b': return PieceBishop;
-      case 'k': return PieceKing;
-      // clang-format on
-      default:
-        return PieceNone;
-    }
-  };
-
-  if (stringEndsWith(move, "e.p."sv)) {
-    stringPop(move, 4);
+  switch (error) {
+    case SanError::None:
+      return "No error";
+    case SanError::Empty:
+      return "Empty SAN move";
+    case SanError::Castling:
+      return "Malformed castling move";
+    case SanError::Piece:
+      return "Invalid piece letter";
+    case SanError::Square:
+      return "Missing or invalid target square";
+    case SanError::Capture:
+      return "Misplaced capture mark";
+    case SanError::Disambiguation:
+      return "Invalid disambiguation";
+    case SanError::Promotion:
+      return "Invalid promotion";
+    case SanError::TrailingCharacters:
+      return "Unexpected characters after the move";
   }
+  return "Unknown error";
+}
 
-  if (stringEndsWith(move, "#"sv) || stringEndsWith(move, "+"sv)) {
-    stringPop(move, 1);
+namespace
+{
+Piece sanPieceType(char c)
+{
+  switch (c) {
+    // clang-format off
+    case 'Q': case 'q': return PieceQueen;
+    case 'R': case 'r': return PieceRook;
+    case 'N': case 'n': return PieceKnight;
+    case 'B': case 'b': return PieceBishop;
+    case 'K': case 'k': return PieceKing;
+    // clang-format on
+    default:
+      return PieceNone;
   }
+}
 
-  if (move == "O-O-O"sv || move == "0-0-0"sv) {
-    return {CastleSide::Queen};
-  } else if (move == "O-O"sv || move == "0-0"sv) {
-    return {CastleSide::King};
-  }
+bool isSanFile(char c)
+{
+  return c >= 'a' && c <= 'h';
+}
 
-  auto promotedTo = PieceNone;
+bool isSanRank(char c)
+{
+  return c >= '1' && c <= '8';
+}
 
-  // If the last letter is not a digit, this is a promotion and it indicates
-  // the promoted-to piece
-  if (!std::isdigit(move.back())) {
-    promotedTo = sanGetPieceType(stringPopBack(move));
+bool isLastRank(char c)
+{
+  return c == '1' || c == '8';
+}
+}  // namespace
 
-    if (promotedTo == PieceNone) {
-      throw std::runtime_error("Malformed SAN move: " + std::string(move));
-    }
-    if (move.back() == '=') {
-      stringPop(move, 1);
-    }
+SANMove SANMove::parse(std::string_view movetext)
+{
+  auto       move  = SANMove{};
+  auto const error = tryParse(movetext, move);
+  if (error != SanError::None) {
+    throw std::runtime_error(std::string(to_string(error)) + ": " + std::string(movetext));
   }
+  return move;
+}
 
-  auto const toRank = stringPopBack(move);
-  auto const toFile = stringPopBack(move);
+SanError SANMove::tryParse(std::string_view movetext, SANMove& out) noexcept
+{
+  using namespace std::literals;
 
-  if (!std::isalpha(toFile)) {
-    throw std::runtime_error("Malformed SAN move: " + std::string(move));
+  auto const size = movetext.size();
+  if (size == 0) {
+    return SanError::Empty;
   }
 
-  auto const toSquare = makeSquare(File(toFile - 'a'), Rank(toRank - '1'));
+  auto i    = std::size_t{0};
+  auto move = SANMove{};
 
-  if (move.size() == 0) {
-    return {File::None, Rank::None, toSquare, promotedTo};
-  }
+  if (movetext[0] == 'O' || movetext[0] == '0') {
+    // O-O and O-O-O, also written with zeros
+    auto const letter = movetext[0];
+    if (size < 3 || movetext[1] != '-' || movetext[2] != letter) {
+      return SanError::Castling;
+    }
 
-  bool isCapture = move.back() == 'x';
+    i = 3;
+    if (i + 1 < size && movetext[i] == '-' && movetext[i + 1] == letter) {
+      i += 2;
+      move = SANMove{CastleSide::Queen};
+    } else {
+      move = SANMove{CastleSide::King};
+    }
+  } else {
+    auto piece = PiecePawn;
+    if (std::isupper(static_cast<unsigned char>(movetext[0]))) {
+      piece = sanPieceType(movetext[0]);
+      if (piece == PieceNone) {
+        return SanError::Piece;
+      }
+      ++i;
+    }
 
-  if (isCapture) {
-    stringPop(move, 1);
-  }
+    // Up to four coordinate characters, the last two of which are the target square. A capture
+    // mark may only come right before the target
+    char coords[4];
+    auto count     = 0;
+    auto captureAt = -1;
+    for (; i < size && count < 4; ++i) {
+      auto const c = movetext[i];
+      if (movetext.substr(i, 4) == "e.p."sv) {
+        break;
+      } else if (c == 'b' && piece == PiecePawn && count >= 2 && isLastRank(coords[count - 1])) {
+        // A pawn never has a rank to disambiguate, so a 'b' after a last rank square is the
+        // promotion piece, as in "e8b"
+        break;
+      } else if (isSanFile(c) || isSanRank(c)) {
+        coords[count++] = c;
+      } else if (c == 'x' && captureAt < 0) {
+        captureAt = count;
+      } else {
+        break;
+      }
+    }
 
-  auto fromFile = File::None;
-  auto fromRank = Rank::None;
+    if (count < 2 || !isSanFile(coords[count - 2]) || !isSanRank(coords[count - 1])) {
+      return SanError::Square;
+    }
+    if (captureAt >= 0 && captureAt != count - 2) {
+      return SanError::Capture;
+    }
 
-  // Check if a rank number was provided
-  if (std::isdigit(move.back())) {
-    fromRank = Rank(stringPopBack(move) - '1');
-  }
+    auto const toSquare = makeSquare(File(coords[count - 2] - 'a'), Rank(coords[count - 1] - '1'));
+
+    auto fromFile = File::None;
+    auto fromRank = Rank::None;
+    if (count == 4) {
+      if (!isSanFile(coords[0]) || !isSanRank(coords[1])) {
+        return SanError::Disambiguation;
+      }
+      fromFile = File(coords[0] - 'a');
+      fromRank = Rank(coords[1] - '1');
+    } else if (count == 3) {
+      if (isSanFile(coords[0])) {
+        fromFile = File(coords[0] - 'a');
+      } else {
+        fromRank = Rank(coords[0] - '1');
+      }
+    }
 
-  // If it's a lower case letter, then it's a file
-  if (std::islower(move.back())) {
-    fromFile = File(stringPopBack(move) - 'a');
+    // A pawn can only be told apart by its file
+    if (piece == PiecePawn && fromRank != Rank::None) {
+      return SanError::Disambiguation;
+    }
 
-    // If there are no more letters, it's a pawn move
-    // find the source square and return it
-    if (move.size() == 0) {
-      return {fromFile, Rank::None, toSquare, promotedTo};
+    // The promotion piece, with or without the '='
+    auto promotedTo = PieceNone;
+    if (i < size && (movetext[i] == '=' || sanPieceType(movetext[i]) != PieceNone)) {
+      i += movetext[i] == '=';
+      promotedTo = i < size ? sanPieceType(movetext[i++]) : PieceNone;
+      if (piece != PiecePawn || promotedTo == PieceNone || promotedTo == PieceKing) {
+        return SanError::Promotion;
+      }
     }
-  }
-  
-  if (promotedTo != PieceNone) {
-    // A promotion must be a pawn move
-    // and so it cannot reach this code, it must return early
-    throw std::runtime_error("Malformed SAN move: " + std::string(move));
-  }
 
-  CHESSGEN_ASSERT(std::isupper(move.back()));
+    if (piece == PiecePawn) {
+      move = SANMove{fromFile, Rank::None, toSquare, promotedTo};
+    } else {
+      move = SANMove{piece, fromFile, fromRank, toSquare};
+    }
+  }
 
-  auto const piece = sanGetPieceType(stringPopBack(move));
+  // Check and mate marks, annotation glyphs and an en passant note may follow the move
+  while (i < size) {
+    auto const c = movetext[i];
+    if (c == '+' || c == '#' || c == '!' || c == '?') {
+      ++i;
+    } else if (movetext.substr(i, 4) == "e.p."sv) {
+      i += 4;
+    } else {
+      return SanError::TrailingCharacters;
+    }
+  }
 
-  CHESSGEN_ASSERT(move.size() == 0);
-  
-  return {piece, fromFile, fromRank, toSquare};
+  out = move;
+  return SanError::None;
 }
 }  // namespace chessgen
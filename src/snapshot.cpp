@@ -0,0 +1,210 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "chessgen/snapshot.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "chessgen/platform.hpp"
+
+namespace chessgen
+{
+// Pointer bits of the published word and the acquire count above them
+static constexpr std::uint64_t _pointerMask = (std::uint64_t{1} << 48) - 1;
+static constexpr std::uint64_t _oneAcquire  = std::uint64_t{1} << 48;
+
+// A reader that sees this many pending acquires folds them into the snapshot's own count. Readers
+// past it do not return before the fold is done, so at most one more acquire per thread is
+// pending, far below what overflows the 16 bit field
+static constexpr std::int64_t _foldThreshold = std::int64_t{1} << 14;
+
+static_assert(sizeof(std::uintptr_t) <= sizeof(std::uint64_t), "Pointers must fit the word");
+
+// Added to the count of a published snapshot so releases can never take it to zero
+static constexpr std::int64_t _publishedBias = std::int64_t{1} << 40;
+
+struct SnapshotPublisher::Node {
+  explicit Node(PositionSnapshot s) : snapshot(std::move(s))
+  {
+  }
+
+  PositionSnapshot          snapshot;
+  std::atomic<std::int64_t> count{_publishedBias};
+};
+
+// -------------------------------------------------------------------------------------------------
+PositionSnapshot::PositionSnapshot(GameHistory history, MoveList legalMoves, GameOverReason reason)
+    : mHistory(std::move(history)),
+      mLegalMoves(std::move(legalMoves)),
+      mFen(mHistory.back().getFen()),
+      mReason(reason)
+{
+}
+// -------------------------------------------------------------------------------------------------
+BoardState const& PositionSnapshot::getState() const
+{
+  return mHistory.back();
+}
+// -------------------------------------------------------------------------------------------------
+GameHistory const& PositionSnapshot::getHistory() const
+{
+  return mHistory;
+}
+// -------------------------------------------------------------------------------------------------
+MoveList const& PositionSnapshot::getLegalMoves() const
+{
+  return mLegalMoves;
+}
+// -------------------------------------------------------------------------------------------------
+std::string const& PositionSnapshot::getFen() const
+{
+  return mFen;
+}
+// -------------------------------------------------------------------------------------------------
+GameOverReason PositionSnapshot::getGameOverReason() const
+{
+  return mReason;
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t PositionSnapshot::getHistorySize() const
+{
+  return mHistory.size();
+}
+// -------------------------------------------------------------------------------------------------
+SnapshotPublisher::Handle::Handle(Node* node) : mNode(node)
+{
+}
+// -------------------------------------------------------------------------------------------------
+SnapshotPublisher::Handle::Handle(Handle const& other) : mNode(other.mNode)
+{
+  if (mNode) {
+    mNode->count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+// -------------------------------------------------------------------------------------------------
+SnapshotPublisher::Handle::Handle(Handle&& other) noexcept : mNode(std::exchange(other.mNode, nullptr))
+{
+}
+// -------------------------------------------------------------------------------------------------
+SnapshotPublisher::Handle& SnapshotPublisher::Handle::operator=(Handle other) noexcept
+{
+  std::swap(mNode, other.mNode);
+  return *this;
+}
+// -------------------------------------------------------------------------------------------------
+SnapshotPublisher::Handle::~Handle()
+{
+  if (mNode) {
+    release(mNode);
+  }
+}
+// -------------------------------------------------------------------------------------------------
+PositionSnapshot const& SnapshotPublisher::Handle::operator*() const
+{
+  CHESSGEN_ASSERT(mNode);
+  return mNode->snapshot;
+}
+// -------------------------------------------------------------------------------------------------
+PositionSnapshot const* SnapshotPublisher::Handle::operator->() const
+{
+  CHESSGEN_ASSERT(mNode);
+  return &mNode->snapshot;
+}
+// -------------------------------------------------------------------------------------------------
+SnapshotPublisher::Handle::operator bool() const
+{
+  return mNode != nullptr;
+}
+// -------------------------------------------------------------------------------------------------
+SnapshotPublisher::~SnapshotPublisher()
+{
+  retire(mWord.load(std::memory_order_acquire));
+}
+// -------------------------------------------------------------------------------------------------
+void SnapshotPublisher::publish(PositionSnapshot snapshot)
+{
+  auto       node = std::make_unique<Node>(std::move(snapshot));
+  auto const bits = reinterpret_cast<std::uintptr_t>(node.get());
+  if ((bits & ~_pointerMask) != 0) {
+    throw std::runtime_error("Snapshot address does not fit in 48 bits");
+  }
+
+  node.release();
+  retire(mWord.exchange(bits, std::memory_order_acq_rel));
+}
+// -------------------------------------------------------------------------------------------------
+SnapshotPublisher::Handle SnapshotPublisher::acquire() const
+{
+  auto const word = mWord.fetch_add(_oneAcquire, std::memory_order_acquire) + _oneAcquire;
+  auto const node = reinterpret_cast<Node*>(word & _pointerMask);
+  if (!node) {
+    // Nothing published yet. The count bits we bumped are dropped by the first publish()
+    return Handle{};
+  }
+
+  // Move the pending acquires into the node's count once in a while. The count is raised first
+  // so that a retire() racing with us can never see it hit zero. If the exchange loses, the
+  // amount is taken back and the fold retried with what is pending now, until it succeeds,
+  // another reader's fold leaves less than the threshold, or the node was retired and retire()
+  // moved the acquires itself. Our own handle is among them, which keeps the count above zero
+  auto pending  = static_cast<std::int64_t>(word >> 48);
+  auto expected = word;
+  while (pending >= _foldThreshold) {
+    node->count.fetch_add(pending, std::memory_order_relaxed);
+    if (mWord.compare_exchange_weak(expected, expected & _pointerMask, std::memory_order_acq_rel,
+                                    std::memory_order_relaxed)) {
+      break;
+    }
+    node->count.fetch_sub(pending, std::memory_order_relaxed);
+    if ((expected & _pointerMask) != (word & _pointerMask)) {
+      break;
+    }
+    pending = static_cast<std::int64_t>(expected >> 48);
+  }
+  return Handle{node};
+}
+// -------------------------------------------------------------------------------------------------
+void SnapshotPublisher::retire(std::uint64_t word)
+{
+  auto const node = reinterpret_cast<Node*>(word & _pointerMask);
+  if (!node) {
+    return;
+  }
+
+  // Swap the bias for the acquires made while the node was published. What is left is the
+  // number of live handles
+  auto const acquires = static_cast<std::int64_t>(word >> 48);
+  auto const delta    = acquires - _publishedBias;
+  if (node->count.fetch_add(delta, std::memory_order_acq_rel) + delta == 0) {
+    delete node;
+  }
+}
+// -------------------------------------------------------------------------------------------------
+void SnapshotPublisher::release(Node* node)
+{
+  if (node->count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete node;
+  }
+}
+}  // namespace chessgen
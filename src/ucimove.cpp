@@ -0,0 +1,145 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "chessgen/ucimove.hpp"
+
+#include "chessgen/board_state.hpp"
+
+namespace chessgen
+{
+namespace
+{
+char* writeSquare(Square square, char* out)
+{
+  *out++ = static_cast<char>('a' + static_cast<int>(getFile(square)));
+  *out++ = static_cast<char>('1' + static_cast<int>(getRank(square)));
+  return out;
+}
+
+bool parseSquare(char file, char rank, Square& out)
+{
+  if (file < 'a' || file > 'h' || rank < '1' || rank > '8') return false;
+
+  out = makeSquare(File(file - 'a'), Rank(rank - '1'));
+  return true;
+}
+
+bool isUciSeparator(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+}  // namespace
+// -------------------------------------------------------------------------------------------------
+std::size_t writeUciMove(UCIMove const& move, Color color, char* out, CastlingNotation notation)
+{
+  static constexpr char promotionChars[PieceCount] = {'p', 'b', 'n', 'r', 'q', 'k'};
+
+  auto const begin = out;
+  if (move.isCastling()) {
+    auto const kingside = move.getCastleSide() == CastleSide::King;
+    auto const rank     = color == ColorWhite ? Rank::Rank1 : Rank::Rank8;
+    auto const file     = notation == CastlingNotation::KingTakesRook
+                              ? (kingside ? File::FileH : File::FileA)
+                              : (kingside ? File::FileG : File::FileC);
+
+    out = writeSquare(makeSquare(File::FileE, rank), out);
+    out = writeSquare(makeSquare(file, rank), out);
+    return static_cast<std::size_t>(out - begin);
+  }
+
+  out = writeSquare(move.fromSquare(), out);
+  out = writeSquare(move.toSquare(), out);
+  if (move.isPromotion()) {
+    *out++ = promotionChars[move.promotedTo()];
+  }
+  return static_cast<std::size_t>(out - begin);
+}
+// -------------------------------------------------------------------------------------------------
+std::string toUciString(UCIMove const& move, Color color, CastlingNotation notation)
+{
+  char buffer[UciMoveMaxLength];
+  return std::string(buffer, writeUciMove(move, color, buffer, notation));
+}
+// -------------------------------------------------------------------------------------------------
+bool parseUciMove(std::string_view text, BoardState const& state, UCIMove& out)
+{
+  if (text.size() != 4 && text.size() != 5) return false;
+
+  auto from = Square::None;
+  auto to   = Square::None;
+  if (!parseSquare(text[0], text[1], from) || !parseSquare(text[2], text[3], to)) return false;
+
+  auto promotedTo = PieceNone;
+  if (text.size() == 5) {
+    switch (text[4]) {
+      // clang-format off
+      case 'q': case 'Q': promotedTo = PieceQueen;  break;
+      case 'r': case 'R': promotedTo = PieceRook;   break;
+      case 'b': case 'B': promotedTo = PieceBishop; break;
+      case 'n': case 'N': promotedTo = PieceKnight; break;
+      // clang-format on
+      default:
+        return false;
+    }
+  }
+
+  return state.resolveMove(from, to, promotedTo, out);
+}
+// -------------------------------------------------------------------------------------------------
+std::size_t parseUciMoves(std::string_view  line,
+                          BoardState const& state,
+                          UCIMove*          out,
+                          std::size_t       capacity,
+                          BoardState*       end,
+                          std::string_view* unparsed)
+{
+  auto position = state;
+  auto count    = std::size_t{0};
+  auto i        = std::size_t{0};
+
+  while (true) {
+    while (i < line.size() && isUciSeparator(line[i])) {
+      ++i;
+    }
+    if (i == line.size() || count == capacity) break;
+
+    auto length = std::size_t{0};
+    while (i + length < line.size() && !isUciSeparator(line[i + length])) {
+      ++length;
+    }
+
+    auto move = UCIMove{};
+    if (!parseUciMove(line.substr(i, length), position, move)) break;
+
+    position.makeMove(move);
+    out[count++] = move;
+    i += length;
+  }
+
+  if (end) {
+    *end = position;
+  }
+  if (unparsed) {
+    *unparsed = line.substr(i);
+  }
+  return count;
+}
+}  // namespace chessgen
@@ -0,0 +1,113 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/arena.hpp>
+#include <chessgen/board.hpp>
+#include <cstdint>
+
+#include "counting_resource.hpp"
+
+using chessgen::ArenaResource;
+using chessgen::SingleThreadBoard;
+using chessgen::Square;
+using chessgen::UCIMove;
+using chessgen::test::CountingResource;
+
+namespace
+{
+UCIMove const game[] = {
+    {Square::E2, Square::E4}, {Square::E7, Square::E5}, {Square::G1, Square::F3},
+    {Square::B8, Square::C6}, {Square::F1, Square::B5}, {Square::G8, Square::F6},
+    {chessgen::CastleSide::King}, {Square::F6, Square::E4}, {Square::D2, Square::D4},
+    {Square::E4, Square::D6}, {Square::B5, Square::C6}, {Square::D7, Square::C6},
+};
+}  // namespace
+
+TEST(Arena, ReusesBlocksAfterReset)
+{
+  CountingResource upstream;
+  ArenaResource    arena(1024, &upstream);
+
+  auto fill = [&arena] {
+    for (std::size_t i = 1; i < 200; ++i) {
+      auto const alignment = std::size_t{1} << (i % 7);
+      auto const p         = arena.allocate(i * 3, alignment);
+      ASSERT_EQ(reinterpret_cast<std::uintptr_t>(p) % alignment, 0u);
+    }
+  };
+
+  fill();
+  auto const allocations = upstream.allocations;
+  auto const used        = arena.getBytesUsed();
+  EXPECT_GT(allocations, 1);
+  EXPECT_GE(arena.getCapacity(), used);
+
+  arena.reset();
+  EXPECT_EQ(arena.getBytesUsed(), 0u);
+  fill();
+  EXPECT_EQ(upstream.allocations, allocations);
+  EXPECT_EQ(arena.getBytesUsed(), used);
+
+  arena.release();
+  EXPECT_EQ(arena.getCapacity(), 0u);
+}
+
+TEST(Arena, BoardAllocatesOnlyFromItsResource)
+{
+  SingleThreadBoard reference;
+  for (auto const& move : game) {
+    ASSERT_TRUE(reference.makeMove(move));
+  }
+
+  CountingResource upstream;
+  ArenaResource    arena(4096, &upstream);
+
+  // Anything that falls back to the default resource now throws
+  auto const previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+  for (int round = 0; round < 2; ++round) {
+    {
+      SingleThreadBoard board(chessgen::ChessVariant::Standard, &arena);
+      board.setHistoryCheckpointInterval(4);
+      for (auto const& move : game) {
+        ASSERT_FALSE(board.getLegalMoves().empty());
+        ASSERT_TRUE(board.makeMove(move));
+      }
+      EXPECT_EQ(board.undoMoves(5), 5u);
+      for (auto i = std::size(game) - 5; i < std::size(game); ++i) {
+        ASSERT_TRUE(board.makeMove(game[i]));
+      }
+
+      EXPECT_EQ(board.getFen(), reference.getFen());
+      EXPECT_EQ(board.getLegalMoves(), reference.getLegalMoves());
+      EXPECT_EQ(board.getLegalMoves().get_allocator().resource(), &arena);
+    }
+
+    // The second game fits in the blocks the first one left behind
+    auto const allocations = upstream.allocations;
+    arena.reset();
+    if (round == 1) {
+      EXPECT_EQ(upstream.allocations, allocations);
+    }
+  }
+  std::pmr::set_default_resource(previous);
+}
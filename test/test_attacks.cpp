@@ -0,0 +1,152 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/attacks.hpp>
+#include <chessgen/board.hpp>
+#include <chessgen/helpers.hpp>
+
+using chessgen::Bitboard;
+namespace Bitboards = chessgen::Bitboards;
+using chessgen::Board;
+using chessgen::Color;
+using chessgen::Square;
+
+TEST(Attacks, AttackMapMatchesSquareQueries)
+{
+  // None of these positions are in check, so no ray goes through a king and
+  // the attack maps must agree with the per-square queries everywhere
+  char const* fens[] = {
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+  };
+
+  for (auto fen : fens) {
+    auto const  board = Board(fen);
+    auto const& state = board.getState();
+    ASSERT_FALSE(state.isInCheck()) << fen;
+
+    for (auto color : {chessgen::ColorWhite, chessgen::ColorBlack}) {
+      for (auto sq = Square::A1; sq <= Square::H8; ++sq) {
+        EXPECT_EQ(!!(state.getAttackedSquares(color) & sq), state.isSquareUnderAttack(color, sq))
+            << fen << " " << chessgen::to_string(sq);
+      }
+    }
+  }
+}
+
+TEST(Attacks, AttackMapSeesThroughKing)
+{
+  // The rook on a1 checks the white king on d1, e1 must still be covered
+  Board board("4k3/8/8/8/8/8/8/r2K4 w - - 0 1");
+
+  EXPECT_TRUE(board.isInCheck());
+  EXPECT_TRUE(board.getState().getAttackedSquares(chessgen::ColorBlack) & Square::E1);
+  EXPECT_FALSE(board.isValid(Square::D1, Square::E1));
+  EXPECT_TRUE(board.isValid(Square::D1, Square::D2));
+}
+
+TEST(Attacks, CastlingNeedsTheRook)
+{
+  // White still holds the K right but the h1 rook was captured. The rook on c8 must not be
+  // mistaken for the castling rook
+  Board board("rnRq1k1r/pp2bppp/2p5/8/2B5/8/PPP1N1PP/RNBQK2n w KQ - 0 9");
+
+  EXPECT_FALSE(board.canShortCastle(chessgen::ColorWhite));
+  EXPECT_FALSE(board.isValid(chessgen::CastleSide::King));
+
+  // Capturing the rook on its original square takes away the right
+  Board other("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1");
+  ASSERT_TRUE(other.makeMove(chessgen::UCIMove{Square::H8, Square::H1}));
+  EXPECT_TRUE(enumHasFlag(other.getState().getCastlingRights(chessgen::ColorWhite),
+                          chessgen::CastleSide::Queen));
+  EXPECT_FALSE(enumHasFlag(other.getState().getCastlingRights(chessgen::ColorWhite),
+                           chessgen::CastleSide::King));
+}
+
+TEST(Attacks, SetwiseSlidersMatchMagics)
+{
+  // Make sure the magic tables are initialized
+  Board board;
+
+  auto seed = std::uint64_t{0x9E3779B97F4A7C15ULL};
+  auto next = [&seed] {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+  };
+
+  for (int i = 0; i < 1000; ++i) {
+    auto const occupied = Bitboard{next() & next()};
+    auto const rooks    = Bitboard{next() & next() & next()} & occupied;
+    auto const bishops  = Bitboard{next() & next() & next()} & occupied;
+
+    auto expectedRooks   = Bitboard{};
+    auto expectedBishops = Bitboard{};
+    for (auto b = rooks; b;) {
+      auto const sq = chessgen::makeSquare(b.popLsb());
+      expectedRooks |= chessgen::attacks::getSlidingAttacks(chessgen::PieceRook, sq, occupied);
+    }
+    for (auto b = bishops; b;) {
+      auto const sq = chessgen::makeSquare(b.popLsb());
+      expectedBishops |= chessgen::attacks::getSlidingAttacks(chessgen::PieceBishop, sq, occupied);
+    }
+
+    ASSERT_EQ(chessgen::attacks::getRookAttacks(rooks, occupied), expectedRooks);
+    ASSERT_EQ(chessgen::attacks::getBishopAttacks(bishops, occupied), expectedBishops);
+    ASSERT_EQ(chessgen::attacks::getSliderAttacks(rooks, bishops, occupied),
+              expectedRooks | expectedBishops);
+  }
+}
+
+TEST(Attacks, LinesAndBetween)
+{
+  // Make sure the tables are initialized
+  Board board;
+
+  using chessgen::attacks::aligned;
+  using chessgen::attacks::getBetween;
+  using chessgen::attacks::getLine;
+
+  EXPECT_EQ(getLine(Square::C3, Square::E5), Bitboard{0x8040201008040201ULL});
+  EXPECT_EQ(getBetween(Square::C3, Square::E5), Bitboard{} | Square::D4);
+  EXPECT_EQ(getLine(Square::B1, Square::B7), Bitboards::FileB);
+  EXPECT_EQ(getBetween(Square::B1, Square::B2), Bitboard{});
+  EXPECT_EQ(getLine(Square::A1, Square::B3), Bitboard{});
+  EXPECT_EQ(getBetween(Square::A1, Square::B3), Bitboard{});
+
+  EXPECT_TRUE(aligned(Square::A1, Square::C3, Square::H8));
+  EXPECT_TRUE(aligned(Square::E4, Square::E2, Square::E8));
+  EXPECT_FALSE(aligned(Square::E4, Square::E2, Square::D8));
+
+  // Between is always the part of the line strictly inside the two squares
+  for (auto s1 = Square::A1; s1 <= Square::H8; ++s1) {
+    for (auto s2 = Square::A1; s2 <= Square::H8; ++s2) {
+      auto const between = getBetween(s1, s2);
+      EXPECT_EQ(between & ~getLine(s1, s2), Bitboard{});
+      EXPECT_FALSE(between & s1);
+      EXPECT_FALSE(between & s2);
+    }
+  }
+}
@@ -124,3 +124,28 @@ TEST(Bitboard, ShiftTowards)
   EXPECT_EQ(board.shiftTowards(chessgen::Direction::South),
             clearSquare(chessgen::Bitboards::FileA, chessgen::Square::A8));
 }
+
+TEST(Bitboard, OccludedFill)
+{
+  using chessgen::Direction;
+  using chessgen::Square;
+
+  Bitboard rook{};
+  rook.setBit(Square::D4);
+
+  Bitboard blockers{};
+  blockers.setBit(Square::D7);
+  blockers.setBit(Square::B4);
+
+  Bitboard north{};
+  for (auto sq : {Square::D4, Square::D5, Square::D6}) north.setBit(sq);
+
+  EXPECT_EQ(rook.occludedFill(Direction::North, ~blockers), north);
+  EXPECT_EQ(rook.occludedFill(Direction::North, ~blockers).shiftTowards(Direction::North),
+            north.shiftTowards(Direction::North));
+
+  // Never wraps around the board edge
+  Bitboard hfile{chessgen::Bitboards::FileH};
+  EXPECT_EQ(hfile.occludedFill(Direction::East, ~Bitboard{}), hfile);
+  EXPECT_EQ(hfile.occludedFill(Direction::West, ~hfile), chessgen::Bitboards::AllSquares);
+}
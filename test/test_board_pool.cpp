@@ -0,0 +1,140 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/board_pool.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "counting_resource.hpp"
+
+using chessgen::BoardPool;
+using chessgen::BoardState;
+using chessgen::SingleThreadBoard;
+using chessgen::Square;
+using chessgen::UCIMove;
+using chessgen::test::CountingResource;
+
+namespace
+{
+char const* const kiwipete = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+}  // namespace
+
+TEST(BoardPool, ResetDoesNotAllocate)
+{
+  CountingResource  resource;
+  SingleThreadBoard board(kiwipete, chessgen::ChessVariant::Standard, &resource);
+  auto const        kiwipeteState = board.getState();
+
+  for (int game = 0; game < 3; ++game) {
+    ASSERT_TRUE(board.makeMove(UCIMove{Square::E2, Square::A6}));
+    ASSERT_TRUE(board.makeMove(UCIMove{Square::B4, Square::C3}));
+    ASSERT_TRUE(board.undoMove());
+    ASSERT_TRUE(board.makeMove(UCIMove{Square::E8, Square::F8}));
+    ASSERT_FALSE(board.getLegalMoves().empty());
+
+    auto const allocations = resource.allocations;
+    board.reset(kiwipeteState);
+    EXPECT_EQ(resource.allocations, allocations);
+
+    EXPECT_EQ(board.getFen(), kiwipete);
+    EXPECT_EQ(board.getHistorySize(), 1u);
+    EXPECT_EQ(board.getLegalMoves().size(), 48u);
+    EXPECT_FALSE(board.undoMove());
+  }
+
+  // Whole games with take-backs on the way. Once the board has played one, it has all the
+  // storage the same game needs again
+  auto perGame = std::vector<int>{};
+  for (int game = 0; game < 4; ++game) {
+    auto const before = resource.allocations;
+    board.reset(kiwipeteState);
+
+    auto seed = std::uint64_t{0x9E3779B97F4A7C15ULL};
+    for (auto ply = 0; ply < 300 && !board.isOver(); ++ply) {
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      auto const& moves = board.getLegalMoves();
+      ASSERT_TRUE(board.makeMove(moves[seed % moves.size()]));
+      if (ply % 7 == 6) {
+        ASSERT_EQ(board.undoMoves(3), 3u);
+      }
+    }
+    EXPECT_GT(board.getHistorySize(), 2u * chessgen::GameHistory::DefaultCheckpointInterval);
+    perGame.push_back(resource.allocations - before);
+  }
+  EXPECT_GT(perGame[0], 0);
+  EXPECT_EQ(perGame[1], 0);
+  EXPECT_EQ(perGame[2], 0);
+  EXPECT_EQ(perGame[3], 0);
+}
+
+TEST(BoardPool, RecyclesBoards)
+{
+  BoardPool pool(1);
+
+  auto first = pool.acquire();
+  auto other = pool.acquire();
+  ASSERT_TRUE(first->makeMove(UCIMove{Square::E2, Square::E4}));
+
+  auto const recycled = first.get();
+  first.reset();
+  other.reset();
+  EXPECT_EQ(pool.getIdleCount(), 1u);
+
+  auto again = pool.acquire(BoardState::fromFen(kiwipete, chessgen::ChessVariant::Standard));
+  EXPECT_EQ(again.get(), recycled);
+  EXPECT_EQ(again->getFen(), kiwipete);
+  EXPECT_EQ(again->getLegalMoves().size(), 48u);
+  EXPECT_EQ(pool.getIdleCount(), 0u);
+
+  again.reset();
+  EXPECT_EQ(pool.acquire()->getLegalMoves().size(), 20u);
+}
+
+TEST(BoardPool, RecycledBoardsStartWithDefaults)
+{
+  BoardPool pool(1);
+
+  // The previous user changes the checkpoint interval
+  auto first = pool.acquire();
+  first->setHistoryCheckpointInterval(3);
+  ASSERT_TRUE(first->makeMove(UCIMove{Square::E2, Square::E4}));
+  ASSERT_EQ(first->getHistory().getCheckpointInterval(), 3);
+
+  auto const recycled = first.get();
+  first.reset();
+
+  auto again = pool.acquire();
+  ASSERT_EQ(again.get(), recycled);
+  EXPECT_EQ(again->getVariant(), chessgen::ChessVariant::Standard);
+  EXPECT_EQ(again->getHistory().getCheckpointInterval(),
+            chessgen::GameHistory::DefaultCheckpointInterval);
+  EXPECT_TRUE(again->isInitialPosition());
+
+  for (auto move : {"e4", "e5", "Nf3", "Nc6"}) {
+    ASSERT_TRUE(again->makeMove(move)) << move;
+  }
+  EXPECT_EQ(again->getStateAt(2).getFen(),
+            "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2");
+}
@@ -0,0 +1,155 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/board.hpp>
+#include <chessgen/helpers.hpp>
+#include <string_view>
+#include <vector>
+
+using chessgen::Board;
+using chessgen::BoardState;
+using chessgen::FenError;
+
+namespace
+{
+std::string_view const positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+    "8/8/8/8/8/8/6k1/4K2R w K - 12 87",
+};
+}  // namespace
+
+TEST(Fen, ParsesValidPositions)
+{
+  // Sets up the attack tables
+  Board board;
+
+  for (auto fen : positions) {
+    auto state = BoardState{};
+    ASSERT_EQ(BoardState::parseFen(fen, state), FenError::None) << fen;
+    EXPECT_EQ(state.getFen(), fen);
+    EXPECT_EQ(BoardState::fromFen(fen, chessgen::ChessVariant::Standard).getFen(), fen);
+  }
+
+  // Move counters are optional and any run of spaces separates fields
+  auto state = BoardState{};
+  ASSERT_EQ(BoardState::parseFen("  8/8/8/8/8/8/6k1/4K2R   b  -  -  ", state), FenError::None);
+  EXPECT_EQ(state.getFen(), "8/8/8/8/8/8/6k1/4K2R b - - 0 1");
+}
+
+TEST(Fen, ReportsTheFirstBadField)
+{
+  Board board;
+
+  std::pair<std::string_view, FenError> const cases[] = {
+      {"", FenError::PiecePlacement},
+      {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1", FenError::PiecePlacement},
+      {"rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FenError::PiecePlacement},
+      {"rnbqkbnr/ppppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FenError::PiecePlacement},
+      {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNX w KQkq - 0 1", FenError::PiecePlacement},
+      {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1", FenError::ActiveColor},
+      {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQxq - 0 1", FenError::Castling},
+      {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e9 0 1", FenError::EnPassant},
+      {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1", FenError::HalfMoves},
+      {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1x", FenError::FullMove},
+      {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0", FenError::FieldCount},
+      {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 x", FenError::FieldCount},
+  };
+
+  for (auto const& [fen, expected] : cases) {
+    auto state = BoardState{};
+    EXPECT_EQ(BoardState::parseFen(fen, state), expected) << fen;
+    EXPECT_THROW(BoardState::fromFen(fen, chessgen::ChessVariant::Standard), std::runtime_error);
+  }
+}
+
+TEST(Fen, ParsesInBulk)
+{
+  Board board;
+
+  auto fens = std::vector<std::string_view>(std::begin(positions), std::end(positions));
+  fens.insert(fens.begin() + 2, "not a fen");
+
+  auto states = std::vector<BoardState>(fens.size());
+  auto errors = std::vector<FenError>(fens.size());
+  EXPECT_EQ(chessgen::parseFens(fens.data(), states.data(), errors.data(), fens.size()),
+            fens.size() - 1);
+
+  for (auto i = std::size_t{0}; i < fens.size(); ++i) {
+    if (i == 2) {
+      EXPECT_EQ(errors[i], FenError::PiecePlacement);
+    } else {
+      EXPECT_EQ(errors[i], FenError::None);
+      EXPECT_EQ(states[i].getFen(), fens[i]);
+    }
+  }
+}
+
+TEST(Fen, SplitSkipsConsecutiveDelimiters)
+{
+  auto const fields = chessgen::stringSplit<char>("a  b   c ", ' ');
+  EXPECT_EQ(fields, (std::vector<std::string>{"a", "b", "c"}));
+
+  auto const all = chessgen::stringSplit<char>("a  b", ' ', false);
+  EXPECT_EQ(all, (std::vector<std::string>{"a", "", "b"}));
+}
+
+TEST(Fen, WritesIntoCallerBuffers)
+{
+  Board board;
+
+  auto states = std::vector<BoardState>{};
+  for (auto fen : positions) {
+    states.push_back(BoardState::fromFen(fen, chessgen::ChessVariant::Standard));
+
+    char buffer[BoardState::FenBufferSize];
+    auto length = states.back().writeFen(buffer, sizeof(buffer));
+    EXPECT_EQ(std::string_view(buffer, length), fen);
+    EXPECT_EQ(buffer[length], '\0');
+
+    // Too small, even by one byte for the NUL, writes nothing
+    EXPECT_EQ(states.back().writeFen(buffer, fen.size()), 0u);
+    EXPECT_EQ(states.back().writeFen(buffer, fen.size() + 1), fen.size());
+  }
+
+  auto expected = std::string{};
+  for (auto fen : positions) {
+    expected.append(fen).append("\n");
+  }
+
+  auto text    = std::string(expected.size(), '?');
+  auto written = std::size_t{0};
+  EXPECT_EQ(chessgen::writeFens(states.data(), states.size(), text.data(), text.size(), &written),
+            expected.size());
+  EXPECT_EQ(written, states.size());
+  EXPECT_EQ(text, expected);
+
+  // Stops at the first position that does not fit
+  auto const firstTwo = positions[0].size() + positions[1].size() + 2;
+  EXPECT_EQ(chessgen::writeFens(states.data(), states.size(), text.data(), firstTwo + 10, &written),
+            firstTwo);
+  EXPECT_EQ(written, 2u);
+}
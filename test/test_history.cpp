@@ -0,0 +1,180 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/board.hpp>
+#include <string>
+#include <vector>
+
+using chessgen::Board;
+using chessgen::GameHistory;
+using chessgen::Square;
+using chessgen::UCIMove;
+
+namespace
+{
+// Castling both ways, en passant and an underpromotion, so every packed move kind shows up
+std::vector<UCIMove> const moves = {
+    {Square::E2, Square::E4},
+    {Square::D7, Square::D5},
+    {Square::E4, Square::E5},
+    {Square::F7, Square::F5},
+    {Square::E5, Square::F6, UCIMove::EnPassant},
+    {Square::G8, Square::H6},
+    {Square::F6, Square::G7},
+    {Square::C8, Square::D7},
+    {Square::G7, Square::H8, chessgen::PieceKnight},
+    {Square::B8, Square::C6},
+    {Square::G1, Square::F3},
+    {Square::E7, Square::E6},
+    {Square::F1, Square::E2},
+    {Square::D8, Square::E7},
+    {chessgen::CastleSide::King},
+    {chessgen::CastleSide::Queen},
+    {Square::H8, Square::G6},
+};
+}  // namespace
+
+TEST(GameHistory, RebuildsEveryPly)
+{
+  for (auto interval : {GameHistory::Full, 3, GameHistory::DefaultCheckpointInterval}) {
+    Board board;
+    board.setHistoryCheckpointInterval(interval);
+
+    auto fens = std::vector<std::string>{board.getFen()};
+    for (auto&& move : moves) {
+      ASSERT_TRUE(board.makeMove(move));
+      fens.push_back(board.getFen());
+    }
+
+    ASSERT_EQ(board.getHistorySize(), fens.size());
+    for (auto ply = std::size_t{0}; ply < fens.size(); ++ply) {
+      EXPECT_EQ(board.getStateAt(ply).getFen(), fens[ply]) << interval << " " << ply;
+    }
+
+    auto const history = board.getGameHistory();
+    ASSERT_EQ(history.size(), fens.size());
+    for (auto ply = std::size_t{0}; ply < moves.size(); ++ply) {
+      EXPECT_EQ(history[ply].boardState.getFen(), fens[ply]);
+      ASSERT_TRUE(history[ply].movePlayed.has_value());
+
+      auto const move = board.getMoveAt(ply);
+      EXPECT_EQ(move.fromSquare(), moves[ply].fromSquare());
+      EXPECT_EQ(move.toSquare(), moves[ply].toSquare());
+      EXPECT_EQ(move.promotedTo(), moves[ply].promotedTo());
+      EXPECT_EQ(move.isEnPassant(), moves[ply].isEnPassant());
+      EXPECT_EQ(move.getCastleSide(), moves[ply].getCastleSide());
+    }
+    EXPECT_FALSE(history.back().movePlayed.has_value());
+
+    // Switching the interval midway keeps the game intact
+    board.setHistoryCheckpointInterval(5);
+    EXPECT_EQ(board.getStateAt(7).getFen(), fens[7]);
+    EXPECT_EQ(board.getFen(), fens.back());
+  }
+}
+
+TEST(GameHistory, ForksShareThePrefix)
+{
+  Board main;
+  main.setHistoryCheckpointInterval(4);
+  for (auto ply = 0; ply < 6; ++ply) {
+    ASSERT_TRUE(main.makeMove(moves[ply]));
+  }
+  auto const forkFen = main.getFen();
+
+  // Both boards keep playing from the fork point with different moves. Ply 6 falls in the
+  // middle of a chunk, so whichever side writes first must not clobber the other
+  auto fork = main;
+  ASSERT_TRUE(fork.makeMove(UCIMove{Square::A2, Square::A3}));
+  ASSERT_TRUE(main.makeMove(moves[6]));
+  ASSERT_TRUE(fork.makeMove(UCIMove{Square::A7, Square::A6}));
+  ASSERT_TRUE(main.makeMove(moves[7]));
+  ASSERT_TRUE(main.makeMove(moves[8]));
+
+  EXPECT_EQ(fork.getHistorySize(), 9u);
+  EXPECT_EQ(main.getHistorySize(), 10u);
+  EXPECT_EQ(fork.getStateAt(6).getFen(), forkFen);
+  EXPECT_EQ(main.getStateAt(6).getFen(), forkFen);
+  EXPECT_EQ(fork.getMoveAt(6).fromSquare(), Square::A2);
+  EXPECT_EQ(main.getMoveAt(6).fromSquare(), moves[6].fromSquare());
+  EXPECT_EQ(main.getMoveAt(8).promotedTo(), chessgen::PieceKnight);
+
+  // A fork of a fork, replayed back from its history, lands on the same position
+  auto grandchild = fork;
+  ASSERT_TRUE(grandchild.makeMove(UCIMove{Square::B2, Square::B3}));
+  auto replay = Board{};
+  for (auto ply = std::size_t{0}; ply + 1 < grandchild.getHistorySize(); ++ply) {
+    ASSERT_TRUE(replay.makeMove(grandchild.getMoveAt(ply)));
+  }
+  EXPECT_EQ(replay.getFen(), grandchild.getFen());
+  EXPECT_EQ(fork.getHistorySize(), 9u);
+
+  // Gathering all the moves at once agrees with asking ply by ply
+  for (auto const* board : {&main, &fork, &grandchild}) {
+    auto const all = board->getHistory().getMoves();
+    ASSERT_EQ(all.size() + 1, board->getHistorySize());
+    for (auto ply = std::size_t{0}; ply < all.size(); ++ply) {
+      EXPECT_EQ(all[ply], board->getMoveAt(ply));
+    }
+  }
+}
+
+TEST(GameHistory, UndoAndRedo)
+{
+  Board board;
+  EXPECT_FALSE(board.undoMove());
+
+  auto fens = std::vector<std::string>{board.getFen()};
+  for (auto&& move : moves) {
+    ASSERT_TRUE(board.makeMove(move));
+    fens.push_back(board.getFen());
+  }
+
+  ASSERT_EQ(board.undoMoves(5), 5u);
+  EXPECT_EQ(board.getHistorySize(), fens.size() - 5);
+  EXPECT_EQ(board.getHistory().getMoves().size(), fens.size() - 6);
+  EXPECT_EQ(board.getFen(), fens[fens.size() - 6]);
+
+  // Stepping back and forth hands out the very same cached move lists
+  auto const cached = board.getLegalMoves().data();
+  ASSERT_TRUE(board.undoMove());
+  ASSERT_TRUE(board.makeMove(moves[moves.size() - 6]));
+  EXPECT_EQ(board.getLegalMoves().data(), cached);
+
+  // Replaying the rest brings back the original game
+  for (auto ply = moves.size() - 5; ply < moves.size(); ++ply) {
+    ASSERT_TRUE(board.makeMove(moves[ply]));
+    EXPECT_EQ(board.getFen(), fens[ply + 1]);
+  }
+
+  // A different move after a takeback starts a new line
+  ASSERT_TRUE(board.undoMove());
+  ASSERT_TRUE(board.makeMove(UCIMove{Square::A2, Square::A3}));
+  EXPECT_EQ(board.getHistorySize(), fens.size());
+  EXPECT_NE(board.getFen(), fens.back());
+  ASSERT_TRUE(board.undoMove());
+  EXPECT_EQ(board.getFen(), fens[fens.size() - 2]);
+
+  EXPECT_EQ(board.undoMoves(100), fens.size() - 2);
+  EXPECT_EQ(board.getFen(), fens.front());
+  EXPECT_EQ(board.getLegalMoves().size(), 20u);
+}
@@ -0,0 +1,74 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/board.hpp>
+#include <thread>
+#include <vector>
+
+using chessgen::Board;
+using chessgen::SingleThreadBoard;
+using chessgen::Square;
+using chessgen::UCIMove;
+
+namespace
+{
+char const* const kiwipete = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+}
+
+TEST(MoveCache, PoliciesAgree)
+{
+  Board             shared(kiwipete);
+  SingleThreadBoard local(kiwipete);
+
+  EXPECT_EQ(shared.getLegalMoves(), local.getLegalMoves());
+  EXPECT_EQ(local.getLegalMoves().size(), 48u);
+
+  ASSERT_TRUE(shared.makeMove(UCIMove{Square::E2, Square::A6}));
+  ASSERT_TRUE(local.makeMove(UCIMove{Square::E2, Square::A6}));
+  EXPECT_EQ(shared.getLegalMoves(), local.getLegalMoves());
+  EXPECT_EQ(shared.getFen(), local.getFen());
+
+  auto copy = local;
+  ASSERT_TRUE(local.undoMove());
+  EXPECT_EQ(local.getLegalMoves().size(), 48u);
+  EXPECT_EQ(copy.getLegalMoves(), shared.getLegalMoves());
+}
+
+TEST(MoveCache, ConcurrentReadersSeeOneList)
+{
+  Board board(kiwipete);
+
+  // All threads race on the empty cache; exactly one list must get published
+  auto results = std::vector<chessgen::MoveList const*>(8);
+  auto threads = std::vector<std::thread>{};
+  for (auto& result : results) {
+    threads.emplace_back([&board, &result] { result = &board.getLegalMoves(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (auto result : results) {
+    EXPECT_EQ(result, &board.getLegalMoves());
+  }
+  EXPECT_EQ(board.getLegalMoves().size(), 48u);
+}
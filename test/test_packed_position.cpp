@@ -0,0 +1,79 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/board.hpp>
+#include <chessgen/packed_position.hpp>
+
+using chessgen::Board;
+using chessgen::BoardState;
+using chessgen::PackedPosition;
+
+TEST(PackedPosition, RoundTrips)
+{
+  char const* fens[] = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+      "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+      "8/8/8/8/8/8/6k1/4K2R w K - 49 65535",
+      "4k3/8/8/8/8/8/8/4K3 b - - 0 1",
+  };
+
+  for (auto fen : fens) {
+    auto const board = Board(fen);
+    auto       packed = PackedPosition{};
+    ASSERT_TRUE(PackedPosition::encode(board.getState(), packed)) << fen;
+
+    auto decoded = BoardState{};
+    ASSERT_TRUE(packed.decode(decoded)) << fen;
+    EXPECT_EQ(decoded.getFen(), fen);
+    EXPECT_EQ(decoded.getAttackedSquares(chessgen::ColorWhite),
+              board.getState().getAttackedSquares(chessgen::ColorWhite));
+  }
+}
+
+TEST(PackedPosition, FormatIsStable)
+{
+  // The initial position, byte for byte. Changing this breaks every stored record
+  auto const expected = std::array<std::uint8_t, PackedPosition::Size>{
+      0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF,  // occupancy
+      0x24, 0x53, 0x36, 0x42, 0x11, 0x11, 0x11, 0x11,  // a1..h2
+      0x99, 0x99, 0x99, 0x99, 0xAC, 0xDB, 0xBE, 0xCA,  // a7..h8
+      0x1E, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00,  // flags, ep, clocks, version
+  };
+
+  auto packed = PackedPosition{};
+  ASSERT_TRUE(PackedPosition::encode(Board().getState(), packed));
+  EXPECT_EQ(packed.getBytes(), expected);
+
+  // Records from unknown versions or with garbage in them are rejected
+  auto state = BoardState{};
+  EXPECT_FALSE(PackedPosition{}.decode(state));
+
+  auto bytes = expected;
+  bytes[30]  = 2;
+  EXPECT_FALSE(PackedPosition{bytes}.decode(state));
+
+  bytes     = expected;
+  bytes[12] = 0x17;  // Piece code 7
+  EXPECT_FALSE(PackedPosition{bytes}.decode(state));
+}
@@ -0,0 +1,95 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/board.hpp>
+#include <chessgen/perft.hpp>
+#include <thread>
+#include <vector>
+
+using chessgen::Board;
+using chessgen::PerftOptions;
+using chessgen::PerftTable;
+using chessgen::Square;
+using chessgen::UCIMove;
+
+TEST(Perft, HashFollowsThePosition)
+{
+  // The same position reached through different move orders
+  Board a;
+  Board b;
+  for (auto move : {"Nf3", "Nf6", "Nc3", "Nc6"}) {
+    ASSERT_TRUE(a.makeMove(move));
+  }
+  for (auto move : {"Nc3", "Nc6", "Nf3", "Nf6"}) {
+    ASSERT_TRUE(b.makeMove(move));
+  }
+  EXPECT_EQ(a.getState().getHash(), b.getState().getHash());
+
+  // Side to move, castling rights and en passant all count
+  auto const hash = [](char const* fen) { return Board(fen).getState().getHash(); };
+  auto const base = hash("r3k2r/8/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1");
+  EXPECT_NE(base, hash("r3k2r/8/8/3pP3/8/8/8/R3K2R b KQkq - 0 1"));
+  EXPECT_NE(base, hash("r3k2r/8/8/3pP3/8/8/8/R3K2R w Kkq d6 0 1"));
+  EXPECT_NE(base, hash("r3k2r/8/8/3pP3/8/8/8/R3K2R w KQkq - 0 1"));
+  EXPECT_EQ(base, hash("r3k2r/8/8/3pP3/8/8/8/R3K2R w KQkq d6 5 9"));
+
+  // Moving a piece there and back only changes the side to move, twice
+  Board c;
+  auto const initial = c.getState().getHash();
+  for (auto move : {"Nf3", "Nf6", "Ng1", "Ng8"}) {
+    ASSERT_TRUE(c.makeMove(move));
+  }
+  EXPECT_EQ(c.getState().getHash(), initial);
+}
+
+TEST(Perft, OptionsKeepTheCounts)
+{
+  auto const kiwipete =
+      Board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1").getState();
+  std::uint64_t const expected[] = {1, 48, 2039, 97862};
+
+  auto table = PerftTable{1};
+  EXPECT_EQ(table.getSize(), 1u << 20);
+  for (auto depth = 0; depth <= 3; ++depth) {
+    EXPECT_EQ(chessgen::perft(kiwipete, depth), expected[depth]);
+    EXPECT_EQ(chessgen::perft(kiwipete, depth, PerftOptions{true, nullptr}), expected[depth]);
+    EXPECT_EQ(chessgen::perft(kiwipete, depth, PerftOptions{false, &table}), expected[depth]);
+  }
+
+  // A table far too small for the tree, shared by threads that all search the same one
+  auto tiny    = PerftTable{0};
+  auto counts  = std::vector<std::uint64_t>(4);
+  auto threads = std::vector<std::thread>{};
+  for (auto i = std::size_t{0}; i < counts.size(); ++i) {
+    threads.emplace_back([&, i] {
+      counts[i] = chessgen::perft(kiwipete, 3, PerftOptions{true, &tiny});
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto count : counts) {
+    EXPECT_EQ(count, 97862u);
+  }
+  EXPECT_EQ(tiny.getSize(), 64u);
+}
@@ -0,0 +1,304 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/pgn_lexer.hpp>
+#include <chessgen/pgn_reader.hpp>
+#include <chessgen/pgn_writer.hpp>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using chessgen::MovetextLexer;
+using chessgen::PgnError;
+using chessgen::PgnGame;
+using chessgen::SingleThreadBoard;
+
+namespace
+{
+char const* const scholarsMate = R"([Event "Casual game"]
+[White "A"]
+[Black "B"]
+[Result "1-0"]
+
+1. e4 e5 2. Bc4 Nc6 3. Qh5 Nf6 4. Qxf7# 1-0
+)";
+
+// What the tests keep of a game once the callback returned
+struct GameSummary {
+  std::size_t index{0};
+  PgnError    error{PgnError::None};
+  std::string errorToken;
+  std::string result;
+  std::string event;
+  std::size_t moves{0};
+  std::string fen;
+};
+
+std::vector<GameSummary> readAll(std::string_view text, chessgen::PgnReadOptions const& options)
+{
+  auto mutex = std::mutex{};
+  auto games = std::vector<GameSummary>{};
+  auto count = chessgen::readPgn(
+      text,
+      [&](PgnGame const& game, SingleThreadBoard const& board) {
+        auto const lock = std::lock_guard<std::mutex>{mutex};
+        if (games.size() <= game.index) games.resize(game.index + 1);
+        games[game.index] = GameSummary{game.index,
+                                        game.error,
+                                        std::string{game.errorToken},
+                                        std::string{game.result},
+                                        std::string{game.getTag("Event")},
+                                        game.moves.size(),
+                                        board.getFen()};
+      },
+      options);
+  EXPECT_EQ(count, games.size());
+  return games;
+}
+}  // namespace
+
+TEST(Pgn, LexerSkipsEverythingButMoves)
+{
+  auto lexer = MovetextLexer{
+      "1.e4 e5 2. Nf3 {a comment (with a paren} (2. f4 exf4 (2... d5) {x} 3. Nf3) 2... Nc6 $14\n"
+      "3. Bb5 ; rest of the line 3... a6\n"
+      "% escaped line 4. d4\n"
+      "3... a6!? 4. O-O 0-0-0 *  5. e5"};
+
+  auto tokens = std::vector<std::string_view>{};
+  auto token  = std::string_view{};
+  while (lexer.next(token)) {
+    tokens.push_back(token);
+  }
+
+  auto const expected =
+      std::vector<std::string_view>{"e4", "e5", "Nf3", "Nc6", "Bb5", "a6!?", "O-O", "0-0-0"};
+  EXPECT_EQ(tokens, expected);
+  EXPECT_EQ(lexer.getResult(), "*");
+
+  auto unterminated = MovetextLexer{"1. d4 {never closed"};
+  ASSERT_TRUE(unterminated.next(token));
+  EXPECT_EQ(token, "d4");
+  EXPECT_FALSE(unterminated.next(token));
+  EXPECT_TRUE(unterminated.getResult().empty());
+}
+
+TEST(Pgn, LexerCrossesBlockBoundaries)
+{
+  // The lexer classifies the text 64 bytes at a time, shift the tokens across every offset
+  auto const chunk = std::string{"12. Qh4xe7+ {a ( and ;} (12... a6 {)} (b5)) b5 $12\r\n"};
+  for (auto pad = std::size_t{0}; pad < 128; ++pad) {
+    auto text = std::string(pad, '\t');
+    for (auto i = 0; i < 20; ++i) {
+      text += chunk;
+    }
+
+    for (auto const& ending : {std::string{"Kg1"}, std::string{"Kg1 1-0"}}) {
+      auto const movetext = text + ending;
+      auto       lexer    = MovetextLexer{movetext};
+      auto tokens = std::vector<std::string_view>{};
+      auto token  = std::string_view{};
+      while (lexer.next(token)) {
+        tokens.push_back(token);
+      }
+
+      ASSERT_EQ(tokens.size(), 41u) << pad;
+      for (auto i = std::size_t{0}; i < 40; i += 2) {
+        EXPECT_EQ(tokens[i], "Qh4xe7+") << pad;
+        EXPECT_EQ(tokens[i + 1], "b5") << pad;
+      }
+      EXPECT_EQ(tokens.back(), "Kg1") << pad;
+      EXPECT_EQ(lexer.getResult(), ending.size() > 3 ? "1-0" : "") << pad;
+    }
+  }
+}
+
+TEST(Pgn, ReplaysGames)
+{
+  auto const text = std::string{scholarsMate} + R"(
+[Event "Endgame"]
+[SetUp "1"]
+[FEN "4k3/8/8/8/8/8/4P3/4K3 w - - 0 1"]
+
+1. e4 {a comment (with a paren} Kd7 (1... Kf7 2. e5) 2. e5 $1 Ke6 1/2-1/2
+
+[Event "Illegal"]
+
+1. e4 e5 2. Ke3 Nf6 0-1
+
+[Event "Broken tag]
+
+1. d4 *
+)";
+
+  auto const games = readAll(text, {4, 1});
+  ASSERT_EQ(games.size(), 4u);
+
+  EXPECT_EQ(games[0].error, PgnError::None);
+  EXPECT_EQ(games[0].event, "Casual game");
+  EXPECT_EQ(games[0].result, "1-0");
+  EXPECT_EQ(games[0].moves, 7u);
+  EXPECT_EQ(games[0].fen, "r1bqkb1r/pppp1Qpp/2n2n2/4p3/2B1P3/8/PPPP1PPP/RNB1K1NR b KQkq - 0 4");
+
+  EXPECT_EQ(games[1].error, PgnError::None);
+  EXPECT_EQ(games[1].result, "1/2-1/2");
+  EXPECT_EQ(games[1].fen.rfind("8/8/4k3/4P3/8/8/8/4K3 w - -", 0), 0u) << games[1].fen;
+
+  // The board is left where the bad move was found
+  EXPECT_EQ(games[2].error, PgnError::Move);
+  EXPECT_EQ(games[2].errorToken, "Ke3");
+  EXPECT_EQ(games[2].moves, 2u);
+  EXPECT_EQ(games[2].fen, "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2");
+
+  EXPECT_EQ(games[3].error, PgnError::Tag);
+  EXPECT_EQ(games[3].errorToken, "[Event \"Broken tag]");
+}
+
+TEST(Pgn, ReadsFiles)
+{
+  auto const path = testing::TempDir() + "chessgen_test_games.pgn";
+  {
+    auto file = std::ofstream{path, std::ios::binary};
+    for (auto i = 0; i < 300; ++i) {
+      file << scholarsMate << "\n";
+    }
+  }
+
+  auto const games = [&] {
+    auto mutex  = std::mutex{};
+    auto result = std::vector<GameSummary>(300);
+    auto count  = chessgen::readPgnFile(
+        path,
+        [&](PgnGame const& game, SingleThreadBoard const& board) {
+          auto const lock            = std::lock_guard<std::mutex>{mutex};
+          result.at(game.index).index = game.index + 1;
+          result.at(game.index).error = game.error;
+          result.at(game.index).moves = game.moves.size();
+          result.at(game.index).fen   = board.isOver() ? "over" : "";
+        },
+        {3, 7});
+    EXPECT_EQ(count, 300u);
+    return result;
+  }();
+  std::remove(path.c_str());
+
+  for (auto i = std::size_t{0}; i < games.size(); ++i) {
+    EXPECT_EQ(games[i].index, i + 1);
+    EXPECT_EQ(games[i].error, PgnError::None);
+    EXPECT_EQ(games[i].moves, 7u);
+    EXPECT_EQ(games[i].fen, "over");
+  }
+
+  EXPECT_THROW(chessgen::readPgnFile(path, [](PgnGame const&, SingleThreadBoard const&) {}),
+               std::runtime_error);
+
+  // Exceptions thrown by the callback come back to the caller
+  EXPECT_THROW(chessgen::readPgn(scholarsMate,
+                                 [](PgnGame const&, SingleThreadBoard const&) {
+                                   throw std::logic_error("stop");
+                                 }),
+               std::logic_error);
+}
+
+TEST(Pgn, WritesGames)
+{
+  auto board = chessgen::Board{};
+  for (auto move : {"e4", "e5", "Bc4", "Nc6", "Qh5", "Nf6", "Qxf7#"}) {
+    ASSERT_TRUE(board.makeMove(move)) << move;
+  }
+
+  auto const tags   = std::vector<chessgen::PgnTag>{{"Event", "Casual game"}, {"White", "A"}};
+  auto const result = chessgen::getPgnResult(board.getGameOverReason(), board.getActivePlayer());
+  auto       text   = std::string{};
+  chessgen::writePgn(board.getHistory(), tags, result, text);
+
+  EXPECT_EQ(text,
+            "[Event \"Casual game\"]\n[White \"A\"]\n[Result \"1-0\"]\n\n"
+            "1. e4 e5 2. Bc4 Nc6 3. Qh5 Nf6 4. Qxf7# 1-0\n\n");
+
+  auto stream = std::ostringstream{};
+  chessgen::writePgn(board.getHistory(), tags, result, stream);
+  EXPECT_EQ(stream.str(), text);
+
+  // Quotes and backslashes in tag values are escaped, and the reader gets them back
+  auto const event  = std::string{R"(The "Immortal" game, C:\games)"};
+  auto const quoted = std::vector<chessgen::PgnTag>{{"Event", event}, {"White", "A"}};
+  text.clear();
+  chessgen::writePgn(board.getHistory(), quoted, result, text);
+  EXPECT_EQ(text.rfind(R"([Event "The \"Immortal\" game, C:\\games"])" "\n", 0), 0u) << text;
+
+  auto const games = readAll(text, {1, 1});
+  ASSERT_EQ(games.size(), 1u);
+  EXPECT_EQ(games[0].error, PgnError::None);
+  EXPECT_EQ(games[0].event, event);
+  EXPECT_EQ(games[0].moves, 7u);
+}
+
+TEST(Pgn, WrittenGamesReadBack)
+{
+  // A random game from a position with black to move, written in short lines
+  auto const fen   = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1";
+  auto       board = chessgen::Board{fen};
+  auto       seed  = std::uint64_t{0x9E3779B97F4A7C15ULL};
+  auto       sans  = std::vector<std::string>{};
+  for (auto ply = 0; ply < 200 && !board.isOver(); ++ply) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    auto const& moves = board.getLegalMoves();
+    auto const  move  = moves[seed % moves.size()];
+    sans.push_back(board.getSanForMove(move));
+    ASSERT_TRUE(board.makeMove(move));
+  }
+
+  auto text = std::string{};
+  chessgen::writePgn(board.getHistory(), {}, "", text, {40});
+  EXPECT_EQ(text.find("[SetUp \"1\"]\n[FEN \"" + std::string{fen} + "\"]\n"),
+            text.find("[SetUp"));
+  EXPECT_NE(text.find("\n\n1... " + sans[0] + " 2. " + sans[1] + " "), std::string::npos);
+
+  auto line = std::istringstream{text};
+  for (auto row = std::string{}; std::getline(line, row);) {
+    if (row.empty() || row[0] != '[') EXPECT_LE(row.size(), 40u) << row;
+  }
+
+  // The reader sees the same moves, each written the way getSanForMove has it
+  auto const games = readAll(text, {1, 1});
+  ASSERT_EQ(games.size(), 1u);
+  EXPECT_EQ(games[0].error, PgnError::None);
+  EXPECT_EQ(games[0].result, "*");
+  EXPECT_EQ(games[0].moves, sans.size());
+  EXPECT_EQ(games[0].fen, board.getFen());
+
+  auto lexer  = MovetextLexer{std::string_view{text}.substr(text.find("\n\n") + 2)};
+  auto token  = std::string_view{};
+  auto tokens = std::vector<std::string>{};
+  while (lexer.next(token)) {
+    tokens.emplace_back(token);
+  }
+  EXPECT_EQ(tokens, sans);
+}
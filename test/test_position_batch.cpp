@@ -0,0 +1,90 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/board.hpp>
+#include <chessgen/position_batch.hpp>
+#include <cstdint>
+#include <vector>
+
+using chessgen::Bitboard;
+using chessgen::Board;
+using chessgen::PositionBatch;
+
+TEST(PositionBatch, KernelsMatchBoardState)
+{
+  char const* fens[] = {
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  };
+
+  // Random playouts give a mix of sides to move, checks and odd batch sizes (SIMD tails)
+  auto boards = std::vector<Board>{};
+  auto seed   = std::uint64_t{0x9e3779b97f4a7c15ULL};
+  for (auto fen : fens) {
+    auto board = Board(fen);
+    for (auto ply = 0; ply < 40 && !board.isOver(); ++ply) {
+      boards.push_back(board);
+
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      auto const& moves = board.getLegalMoves();
+      ASSERT_TRUE(board.makeMove(moves[seed % moves.size()]));
+    }
+  }
+
+  auto batch = PositionBatch(boards.size());
+  for (auto const& board : boards) {
+    batch.push_back(board.getState());
+  }
+  ASSERT_EQ(batch.size(), boards.size());
+
+  auto white    = std::vector<Bitboard>(batch.size());
+  auto black    = std::vector<Bitboard>(batch.size());
+  auto checkers = std::vector<Bitboard>(batch.size());
+  auto inCheck  = std::vector<std::uint8_t>(batch.size());
+  auto counts   = std::vector<int>(batch.size());
+  batch.computeAttackMaps(chessgen::ColorWhite, white.data());
+  batch.computeAttackMaps(chessgen::ColorBlack, black.data());
+  batch.computeCheckers(checkers.data());
+  batch.computeInCheck(inCheck.data());
+  batch.countLegalMoves(counts.data());
+
+  for (auto i = std::size_t{0}; i < boards.size(); ++i) {
+    auto const& state = boards[i].getState();
+    EXPECT_EQ(white[i], state.getAttackedSquares(chessgen::ColorWhite)) << i;
+    EXPECT_EQ(black[i], state.getAttackedSquares(chessgen::ColorBlack)) << i;
+    EXPECT_EQ(checkers[i], state.getCheckers()) << i;
+    EXPECT_EQ(!!inCheck[i], state.isInCheck()) << i;
+    EXPECT_EQ(counts[i], static_cast<int>(boards[i].getLegalMoves().size())) << i;
+
+    auto const copy = batch.getState(i);
+    EXPECT_EQ(copy.getOccupied(), state.getOccupied()) << i;
+    EXPECT_EQ(copy.getEnPassant(), state.getEnPassant()) << i;
+    EXPECT_EQ(copy.getActivePlayer(), state.getActivePlayer()) << i;
+    EXPECT_EQ(copy.getCastlingRights(chessgen::ColorWhite),
+              state.getCastlingRights(chessgen::ColorWhite))
+        << i;
+  }
+}
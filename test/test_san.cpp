@@ -0,0 +1,252 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <chessgen/board.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+using chessgen::Board;
+using chessgen::CastleSide;
+using chessgen::Square;
+using chessgen::UCIMove;
+
+namespace
+{
+bool hasMove(std::vector<std::string> const& moves, std::string const& san)
+{
+  return std::find(moves.begin(), moves.end(), san) != moves.end();
+}
+}  // namespace
+
+TEST(San, PiecesCapturesAndCastling)
+{
+  Board board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+  EXPECT_EQ(board.getSanForMove(UCIMove{Square::E5, Square::F7}), "Nxf7");
+  EXPECT_EQ(board.getSanForMove(UCIMove{Square::E2, Square::A6}), "Bxa6");
+  EXPECT_EQ(board.getSanForMove(UCIMove{Square::D5, Square::E6}), "dxe6");
+  EXPECT_EQ(board.getSanForMove(UCIMove{Square::D5, Square::D6}), "d6");
+  EXPECT_EQ(board.getSanForMove(UCIMove{Square::C3, Square::B5}), "Nb5");
+  EXPECT_EQ(board.getSanForMove(UCIMove{CastleSide::King}), "O-O");
+  EXPECT_EQ(board.getSanForMove(UCIMove{CastleSide::Queen}), "O-O-O");
+
+  Board enPassant("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3");
+  EXPECT_EQ(enPassant.getSanForMove(UCIMove{Square::E5, Square::F6}), "exf6");
+}
+
+TEST(San, Disambiguation)
+{
+  auto const byFile = Board("7k/8/8/8/8/8/8/R4RK1 w - - 0 1").getLegalMovesAsSAN();
+  EXPECT_TRUE(hasMove(byFile, "Rae1"));
+  EXPECT_TRUE(hasMove(byFile, "Rfe1"));
+  EXPECT_TRUE(hasMove(byFile, "Ra7"));
+
+  auto const byRank = Board("7k/8/8/R7/8/8/8/R5K1 w - - 0 1").getLegalMovesAsSAN();
+  EXPECT_TRUE(hasMove(byRank, "R5a3"));
+  EXPECT_TRUE(hasMove(byRank, "R1a3"));
+  EXPECT_TRUE(hasMove(byRank, "Rb5"));
+
+  // The a1 queen shares its file with one queen and its rank with the other
+  auto const bySquare = Board("6k1/8/8/8/8/Q7/8/Q1Q4K w - - 0 1").getLegalMovesAsSAN();
+  EXPECT_TRUE(hasMove(bySquare, "Qa1b2"));
+  EXPECT_TRUE(hasMove(bySquare, "Q3b2"));
+  EXPECT_TRUE(hasMove(bySquare, "Qcb2"));
+}
+
+TEST(San, PromotionsChecksAndMates)
+{
+  Board promotion("8/P6k/8/8/8/8/8/K7 w - - 0 1");
+  EXPECT_EQ(promotion.getSanForMove(UCIMove{Square::A7, Square::A8, chessgen::PieceQueen}),
+            "a8=Q");
+  EXPECT_EQ(promotion.getSanForMove(UCIMove{Square::A7, Square::A8, chessgen::PieceKnight}),
+            "a8=N");
+
+  Board backRank("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+  EXPECT_EQ(backRank.getSanForMove(UCIMove{Square::A1, Square::A8}), "Ra8#");
+  EXPECT_TRUE(backRank.getState().isMoveMate(UCIMove{Square::A1, Square::A8}));
+  EXPECT_EQ(backRank.getSanForMove(UCIMove{Square::A1, Square::A7}), "Ra7");
+
+  // The king steps off the rook's line and uncovers it
+  Board discovered("4k3/8/8/8/4K3/8/8/4R3 w - - 0 1");
+  EXPECT_EQ(discovered.getSanForMove(UCIMove{Square::E4, Square::D4}), "Kd4+");
+  EXPECT_TRUE(discovered.getState().isMoveCheck(UCIMove{Square::E4, Square::D4}));
+  EXPECT_FALSE(discovered.getState().isMoveMate(UCIMove{Square::E4, Square::D4}));
+  EXPECT_FALSE(discovered.getState().isMoveCheck(UCIMove{Square::E4, Square::E5}));
+}
+
+TEST(San, BatchMatchesSingleMoves)
+{
+  char const* fens[] = {
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+      "6k1/8/8/8/8/Q7/8/Q1Q4K w - - 0 1",
+  };
+
+  for (auto fen : fens) {
+    Board       board(fen);
+    auto const& moves = board.getLegalMoves();
+    auto const  san   = board.getLegalMovesAsSAN();
+    ASSERT_EQ(san.size(), moves.size()) << fen;
+
+    for (auto i = std::size_t{0}; i < moves.size(); ++i) {
+      auto const single = board.getSanForMove(moves[i]);
+      EXPECT_EQ(san[i], single) << fen;
+
+      // Every move in the list is told apart from the others
+      EXPECT_EQ(std::count(san.begin(), san.end(), single), 1) << fen << " " << single;
+
+      // And the suffix agrees with the position after the move
+      auto next = board;
+      ASSERT_TRUE(next.makeMove(moves[i]));
+      auto const suffix = single.back();
+      EXPECT_EQ(suffix == '+' || suffix == '#', next.isInCheck()) << fen << " " << single;
+      EXPECT_EQ(suffix == '#', next.isInCheck() && next.getLegalMoves().empty())
+          << fen << " " << single;
+    }
+  }
+}
+
+TEST(San, TryParse)
+{
+  using chessgen::SANMove;
+  using chessgen::SanError;
+
+  auto move = SANMove{};
+  ASSERT_EQ(SANMove::tryParse("Nbd7", move), SanError::None);
+  EXPECT_EQ(move.piece(), chessgen::PieceKnight);
+  EXPECT_EQ(move.fromFile(), chessgen::File::FileB);
+  EXPECT_EQ(move.fromRank(), chessgen::Rank::None);
+  EXPECT_EQ(move.toSquare(), Square::D7);
+
+  ASSERT_EQ(SANMove::tryParse("Qa1xb2#", move), SanError::None);
+  EXPECT_EQ(move.piece(), chessgen::PieceQueen);
+  EXPECT_EQ(move.fromFile(), chessgen::File::FileA);
+  EXPECT_EQ(move.fromRank(), chessgen::Rank::Rank1);
+  EXPECT_EQ(move.toSquare(), Square::B2);
+
+  ASSERT_EQ(SANMove::tryParse("bxc8=N+", move), SanError::None);
+  EXPECT_EQ(move.piece(), chessgen::PiecePawn);
+  EXPECT_EQ(move.fromFile(), chessgen::File::FileB);
+  EXPECT_EQ(move.promotedTo(), chessgen::PieceKnight);
+
+  // Lowercase promotion pieces, the bishop included
+  for (auto [text, piece] : {std::pair{"e8q", chessgen::PieceQueen},
+                             std::pair{"e8r", chessgen::PieceRook},
+                             std::pair{"e8b", chessgen::PieceBishop},
+                             std::pair{"dxe1=b+", chessgen::PieceBishop},
+                             std::pair{"axb8n", chessgen::PieceKnight}}) {
+    ASSERT_EQ(SANMove::tryParse(text, move), SanError::None) << text;
+    EXPECT_EQ(move.promotedTo(), piece) << text;
+  }
+  EXPECT_EQ(move.toSquare(), Square::B8);
+
+  ASSERT_EQ(SANMove::tryParse("exd6e.p.", move), SanError::None);
+  EXPECT_EQ(move.toSquare(), Square::D6);
+
+  ASSERT_EQ(SANMove::tryParse("0-0-0!?", move), SanError::None);
+  EXPECT_EQ(move.getCastleSide(), CastleSide::Queen);
+
+  // A failed parse leaves out alone
+  EXPECT_EQ(SANMove::tryParse("", move), SanError::Empty);
+  EXPECT_EQ(SANMove::tryParse("O-", move), SanError::Castling);
+  EXPECT_EQ(SANMove::tryParse("Xe4", move), SanError::Piece);
+  EXPECT_EQ(SANMove::tryParse("Nz4", move), SanError::Square);
+  EXPECT_EQ(SANMove::tryParse("e9", move), SanError::Square);
+  EXPECT_EQ(SANMove::tryParse("Nxbd7", move), SanError::Capture);
+  EXPECT_EQ(SANMove::tryParse("N1bd7", move), SanError::Disambiguation);
+  EXPECT_EQ(SANMove::tryParse("Ne8=Q", move), SanError::Promotion);
+  EXPECT_EQ(SANMove::tryParse("e8=K", move), SanError::Promotion);
+  EXPECT_EQ(SANMove::tryParse("e4 1-0", move), SanError::TrailingCharacters);
+  EXPECT_EQ(move.getCastleSide(), CastleSide::Queen);
+
+  EXPECT_THROW(SANMove::parse("Nz4"), std::runtime_error);
+}
+
+TEST(San, TrySanToUci)
+{
+  Board board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+  EXPECT_EQ(board.trySanToUci("Nxf7"), (UCIMove{Square::E5, Square::F7}));
+  EXPECT_EQ(board.trySanToUci("O-O"), UCIMove{CastleSide::King});
+  EXPECT_EQ(board.trySanToUci("Qxh3"), (UCIMove{Square::F3, Square::H3}));
+  EXPECT_FALSE(board.trySanToUci("Nf3?!x"));
+  EXPECT_FALSE(board.trySanToUci("Ke3"));
+  EXPECT_FALSE(board.isValid("Ng9"));
+  EXPECT_FALSE(board.makeMove("Ng9"));
+
+  // The promotion piece has to match
+  Board promotion("8/P6k/8/8/8/8/8/K7 w - - 0 1");
+  EXPECT_EQ(promotion.trySanToUci("a8=N"),
+            (UCIMove{Square::A7, Square::A8, chessgen::PieceKnight}));
+  EXPECT_FALSE(promotion.trySanToUci("a8"));
+}
+
+TEST(San, ResolvesLikeTheLegalMoves)
+{
+  char const* fens[] = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  };
+  char const pieceChars[] = {'\0', 'B', 'N', 'R', 'Q', 'K'};
+
+  auto seed = std::uint32_t{12345};
+  for (auto fen : fens) {
+    Board board(fen);
+    for (auto ply = 0; ply < 60 && !board.isOver(); ++ply) {
+      auto const& state = board.getState();
+      auto const& moves = board.getLegalMoves();
+
+      // Every legal move comes back from its own SAN
+      for (auto const& move : moves) {
+        auto const san = board.getSanForMove(move);
+        EXPECT_EQ(board.trySanToUci(san), move) << board.getFen() << " " << san;
+      }
+
+      // And a bare piece and target resolves exactly when some legal move matches it
+      for (auto piece = 0; piece < chessgen::PieceCount; ++piece) {
+        for (auto to = Square::A1; to <= Square::H8; ++to) {
+          auto text = std::string{};
+          if (pieceChars[piece]) text += pieceChars[piece];
+          text += chessgen::to_string(to);
+
+          auto const expected = std::any_of(moves.begin(), moves.end(), [&](UCIMove const& m) {
+            return !m.isCastling() && !m.isPromotion() && m.toSquare() == to &&
+                   state.getPieceOn(m.fromSquare()).type == piece;
+          });
+          EXPECT_EQ(board.isValid(text), expected) << board.getFen() << " " << text;
+        }
+      }
+
+      seed = seed * 1664525 + 1013904223;
+      ASSERT_TRUE(board.makeMove(moves[(seed >> 8) % moves.size()]));
+    }
+  }
+}
@@ -0,0 +1,136 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chessgen/board.hpp>
+#include <chessgen/movegen.hpp>
+#include <chessgen/snapshot.hpp>
+#include <thread>
+#include <vector>
+
+using chessgen::Board;
+using chessgen::SnapshotPublisher;
+using chessgen::Square;
+using chessgen::UCIMove;
+
+TEST(Snapshot, CapturesTheBoard)
+{
+  SnapshotPublisher publisher;
+  EXPECT_FALSE(publisher.acquire());
+
+  Board board;
+  publisher.publish(board.createSnapshot());
+  auto const initial = publisher.acquire();
+
+  ASSERT_TRUE(board.makeMove(UCIMove{Square::E2, Square::E4}));
+  publisher.publish(board.createSnapshot());
+  auto const latest = publisher.acquire();
+
+  // The old handle keeps its snapshot alive and unchanged
+  ASSERT_TRUE(initial);
+  EXPECT_EQ(initial->getFen(), "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+  EXPECT_EQ(initial->getHistorySize(), 1u);
+  EXPECT_EQ(initial->getLegalMoves().size(), 20u);
+
+  ASSERT_TRUE(latest);
+  EXPECT_EQ(latest->getFen(), board.getFen());
+  EXPECT_EQ(latest->getLegalMoves(), board.getLegalMoves());
+  EXPECT_EQ(latest->getHistory().getMove(0), (UCIMove{Square::E2, Square::E4}));
+
+  // Taking moves back on the board must not reach into the snapshot's history
+  ASSERT_TRUE(board.undoMove());
+  ASSERT_TRUE(board.makeMove(UCIMove{Square::D2, Square::D4}));
+  EXPECT_EQ(latest->getHistory().getMove(0), (UCIMove{Square::E2, Square::E4}));
+  EXPECT_EQ(latest->getHistory().back().getFen(), latest->getFen());
+}
+
+TEST(Snapshot, ManyAcquiresOfOneSnapshot)
+{
+  // Enough acquires to overflow the packed count many times over if they were never folded, from
+  // enough readers that folds keep losing their compare-exchange to plain acquires
+  SnapshotPublisher publisher;
+  publisher.publish(Board().createSnapshot());
+
+  auto threads = std::vector<std::thread>{};
+  for (int i = 0; i < 16; ++i) {
+    threads.emplace_back([&publisher] {
+      auto held = std::vector<SnapshotPublisher::Handle>{};
+      for (int j = 0; j < 25000; ++j) {
+        auto handle = publisher.acquire();
+        ASSERT_EQ(handle->getHistorySize(), 1u);
+        if (j % 1000 == 0) {
+          held.push_back(std::move(handle));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(publisher.acquire()->getLegalMoves().size(), 20u);
+}
+
+TEST(Snapshot, ReadersRaceTheWriter)
+{
+  SnapshotPublisher publisher;
+  Board             board;
+  publisher.publish(board.createSnapshot());
+
+  auto done    = std::atomic<bool>{false};
+  auto readers = std::vector<std::thread>{};
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&publisher, &done] {
+      auto lastSize = std::size_t{0};
+      while (!done.load(std::memory_order_acquire)) {
+        auto const snapshot = publisher.acquire();
+        auto const& state   = snapshot->getState();
+
+        // The writer only ever moves forward
+        ASSERT_GE(snapshot->getHistorySize(), lastSize);
+        lastSize = snapshot->getHistorySize();
+
+        ASSERT_EQ(snapshot->getFen(), state.getFen());
+        ASSERT_EQ(snapshot->getHistory().getState(lastSize - 1).getFen(), snapshot->getFen());
+        ASSERT_EQ(snapshot->getLegalMoves(),
+                  chessgen::generateMoves<chessgen::GenType::Legal>(state));
+      }
+    });
+  }
+
+  // Play the first legal move until the game ends, with a detour on every ply so the board
+  // keeps rewriting the tail of its history while readers hold on to it
+  for (int ply = 0; ply < 200 && !board.isOver(); ++ply) {
+    auto const moves = board.getLegalMoves();
+    ASSERT_TRUE(board.makeMove(moves.back()));
+    ASSERT_TRUE(board.undoMove());
+    ASSERT_TRUE(board.makeMove(moves.front()));
+    publisher.publish(board.createSnapshot());
+  }
+  done.store(true, std::memory_order_release);
+
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(publisher.acquire()->getFen(), board.getFen());
+}
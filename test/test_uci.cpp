@@ -0,0 +1,120 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//
+#include <gtest/gtest.h>
+
+#include <chessgen/board.hpp>
+#include <string_view>
+
+using chessgen::Board;
+using chessgen::BoardState;
+using chessgen::CastleSide;
+using chessgen::CastlingNotation;
+using chessgen::Square;
+using chessgen::UCIMove;
+
+TEST(Uci, WritesMoves)
+{
+  using chessgen::ColorBlack;
+  using chessgen::ColorWhite;
+  using chessgen::toUciString;
+
+  EXPECT_EQ(toUciString(UCIMove{Square::E2, Square::E4}, ColorWhite), "e2e4");
+  EXPECT_EQ(toUciString(UCIMove{Square::B2, Square::A1, chessgen::PieceKnight}, ColorBlack),
+            "b2a1n");
+  EXPECT_EQ(toUciString(UCIMove{Square::E5, Square::D6, UCIMove::EnPassant}, ColorWhite), "e5d6");
+
+  EXPECT_EQ(toUciString(UCIMove{CastleSide::King}, ColorWhite), "e1g1");
+  EXPECT_EQ(toUciString(UCIMove{CastleSide::Queen}, ColorBlack), "e8c8");
+  EXPECT_EQ(toUciString(UCIMove{CastleSide::King}, ColorWhite, CastlingNotation::KingTakesRook),
+            "e1h1");
+  EXPECT_EQ(toUciString(UCIMove{CastleSide::Queen}, ColorBlack, CastlingNotation::KingTakesRook),
+            "e8a8");
+}
+
+TEST(Uci, RoundTripsLegalMoves)
+{
+  char const* fens[] = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1",
+      "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+  };
+
+  for (auto fen : fens) {
+    Board       board(fen);
+    auto const& state = board.getState();
+    for (auto const& move : board.getLegalMoves()) {
+      for (auto notation : {CastlingNotation::KingMove, CastlingNotation::KingTakesRook}) {
+        auto const text   = chessgen::toUciString(move, state.getActivePlayer(), notation);
+        auto       parsed = UCIMove{};
+        ASSERT_TRUE(chessgen::parseUciMove(text, state, parsed)) << fen << " " << text;
+        EXPECT_EQ(parsed, move) << fen << " " << text;
+      }
+    }
+  }
+}
+
+TEST(Uci, RejectsBadMoves)
+{
+  Board       board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+  auto const& state = board.getState();
+  auto        move  = UCIMove{};
+
+  for (auto text : {"", "e2", "e2e4q", "e2e9", "i2i4", "e2e4x", "0000", "e2e4 ", "e1e2",
+                    "a1a3", "e5e6", "d5d7", "e1c1q", "a2a3k"}) {
+    EXPECT_FALSE(chessgen::parseUciMove(text, state, move)) << text;
+  }
+
+  // A pawn reaching the last rank has to say what it promotes to
+  Board promotion("8/P6k/8/8/8/8/8/K7 w - - 0 1");
+  EXPECT_FALSE(chessgen::parseUciMove("a7a8", promotion.getState(), move));
+  ASSERT_TRUE(chessgen::parseUciMove("a7a8R", promotion.getState(), move));
+  EXPECT_EQ(move, (UCIMove{Square::A7, Square::A8, chessgen::PieceRook}));
+}
+
+TEST(Uci, ParsesMoveLists)
+{
+  Board board;
+
+  UCIMove moves[16];
+  auto    end      = BoardState{};
+  auto    unparsed = std::string_view{};
+  auto    count    = chessgen::parseUciMoves("e2e4 e7e5  g1f3 b8c6 f1c4 g8f6 e1h1 f6e4 ",
+                                       board.getState(), moves, 16, &end, &unparsed);
+  ASSERT_EQ(count, 8u);
+  EXPECT_TRUE(unparsed.empty());
+  EXPECT_EQ(moves[6], UCIMove{CastleSide::King});
+  EXPECT_EQ(moves[7], (UCIMove{Square::F6, Square::E4}));
+  EXPECT_EQ(end.getFen(), "r1bqkb1r/pppp1ppp/2n5/4p3/2B1n3/5N2/PPPP1PPP/RNBQ1RK1 w kq - 0 5");
+
+  // Stops at the first move that is not legal, and when out is full
+  count = chessgen::parseUciMoves("e2e4 e7e5 e4e5 d2d4", board.getState(), moves, 16, nullptr,
+                                  &unparsed);
+  EXPECT_EQ(count, 2u);
+  EXPECT_EQ(unparsed, "e4e5 d2d4");
+
+  count = chessgen::parseUciMoves("e2e4 e7e5 d2d4", board.getState(), moves, 1, &end, &unparsed);
+  EXPECT_EQ(count, 1u);
+  EXPECT_EQ(unparsed, "e7e5 d2d4");
+  EXPECT_EQ(end.getActivePlayer(), chessgen::ColorBlack);
+}
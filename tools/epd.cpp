@@ -0,0 +1,229 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+//
+// Runs perft over the positions of an EPD file and checks the counts against the ones it lists,
+// in the usual "<fen> ;D1 20 ;D2 400 ..." form.
+//
+//   chessgen_epd [--depth N] [--threads N] [--bulk] [--hash MB] <file.epd>
+//
+// Positions are spread over a pool of threads. Each one is reported with its time and speed,
+// followed by every count that did not match. Exits with 1 on any mismatch and 2 if the file
+// cannot be read.
+//
+// --bulk counts the last ply without playing it and --hash shares a perft table of that many
+// megabytes between the threads, see PerftOptions.
+//
+
+#include <chessgen/attacks.hpp>
+#include <chessgen/board_state.hpp>
+#include <chessgen/perft.hpp>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace chessgen;
+
+namespace
+{
+constexpr int _maxDepth = 6;
+
+struct EpdPosition {
+  std::size_t   line{0};
+  std::string   fen;
+  BoardState    state;
+  std::uint64_t expected[_maxDepth + 1]{};  // 0 when the file gives no count for that depth
+  std::uint64_t found[_maxDepth + 1]{};
+  std::uint64_t nodes{0};
+  double        seconds{0};
+};
+
+std::string_view trim(std::string_view text)
+{
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+  while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+// -------------------------------------------------------------------------------------------------
+// Reads the positions, failing on the first line that is not a valid FEN with its counts
+bool loadEpd(char const* path, std::vector<EpdPosition>& positions)
+{
+  auto file = std::ifstream{path};
+  if (!file) {
+    std::fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+
+  auto text = std::string{};
+  for (auto line = std::size_t{1}; std::getline(file, text); ++line) {
+    auto rest = trim(text);
+    if (rest.empty() || rest.front() == '#') continue;
+
+    auto position = EpdPosition{};
+    position.line = line;
+
+    auto const semicolon = rest.find(';');
+    position.fen         = std::string{trim(rest.substr(0, semicolon))};
+    if (BoardState::parseFen(position.fen, position.state) != FenError::None) {
+      std::fprintf(stderr, "%s:%zu: invalid FEN\n", path, line);
+      return false;
+    }
+
+    // Perft counts look like "D3 8902", one per operation. Other operations are ignored
+    rest = semicolon == std::string_view::npos ? std::string_view{} : rest.substr(semicolon + 1);
+    while (!rest.empty()) {
+      auto const end   = rest.find(';');
+      auto const field = trim(rest.substr(0, end));
+      rest             = end == std::string_view::npos ? std::string_view{} : rest.substr(end + 1);
+      if (field.size() < 2 || field[0] != 'D' || field[1] < '0' || field[1] > '9') continue;
+
+      auto const depth  = field[1] - '0';
+      auto const digits = field.substr(std::min<std::size_t>(field.size(), 3));
+      auto const last   = digits.data() + digits.size();
+      auto       count  = std::uint64_t{0};
+      if (depth < 1 || depth > _maxDepth || field.size() < 4 || field[2] != ' ' ||
+          std::from_chars(digits.data(), last, count).ptr != last) {
+        std::fprintf(stderr, "%s:%zu: bad perft count \"%.*s\"\n", path, line,
+                     static_cast<int>(field.size()), field.data());
+        return false;
+      }
+      position.expected[depth] = count;
+    }
+    positions.push_back(std::move(position));
+  }
+  return true;
+}
+// -------------------------------------------------------------------------------------------------
+void runPosition(EpdPosition& position, int maxDepth, PerftOptions const& options)
+{
+  auto const begin = std::chrono::steady_clock::now();
+  for (auto depth = 1; depth <= maxDepth; ++depth) {
+    if (position.expected[depth] == 0) continue;
+
+    position.found[depth] = perft(position.state, depth, options);
+    position.nodes += position.found[depth];
+  }
+  auto const end   = std::chrono::steady_clock::now();
+  position.seconds = std::chrono::duration<double>(end - begin).count();
+}
+// -------------------------------------------------------------------------------------------------
+int usage()
+{
+  std::fprintf(stderr,
+               "usage: chessgen_epd [--depth N] [--threads N] [--bulk] [--hash MB] <file.epd>\n");
+  return 2;
+}
+}  // namespace
+
+// -------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  auto depth   = _maxDepth;
+  auto threads = std::max(1u, std::thread::hardware_concurrency());
+  auto bulk    = false;
+  auto hash    = 0;  // Megabytes
+  auto path    = static_cast<char const*>(nullptr);
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = std::string_view{argv[i]};
+    if (arg == "--depth" && i + 1 < argc) {
+      depth = std::clamp(std::atoi(argv[++i]), 1, _maxDepth);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+    } else if (arg == "--bulk") {
+      bulk = true;
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hash = std::max(0, std::atoi(argv[++i]));
+    } else if (!path && !arg.empty() && arg[0] != '-') {
+      path = argv[i];
+    } else {
+      return usage();
+    }
+  }
+  if (!path) return usage();
+
+  // Boards set the attack tables up on first use, bare states need them before parsing
+  attacks::precomputeTables();
+
+  auto positions = std::vector<EpdPosition>{};
+  if (!loadEpd(path, positions)) return 2;
+
+  auto table = std::unique_ptr<PerftTable>{};
+  if (hash > 0) table = std::make_unique<PerftTable>(static_cast<std::size_t>(hash));
+  auto const options = PerftOptions{bulk, table.get()};
+
+  // Workers take the next position off a shared counter, so long and short ones even out
+  auto       nextIndex = std::atomic<std::size_t>{0};
+  auto const begin     = std::chrono::steady_clock::now();
+  auto       workers   = std::vector<std::thread>{};
+  for (auto i = 0u; i < std::min<std::size_t>(threads, positions.size()); ++i) {
+    workers.emplace_back([&] {
+      for (auto index = nextIndex++; index < positions.size(); index = nextIndex++) {
+        runPosition(positions[index], depth, options);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto const end     = std::chrono::steady_clock::now();
+  auto const seconds = std::chrono::duration<double>(end - begin).count();
+
+  auto mismatches = std::size_t{0};
+  auto nodes      = std::uint64_t{0};
+  for (auto const& position : positions) {
+    auto failed = false;
+    for (auto d = 1; d <= depth; ++d) {
+      failed |= position.found[d] != position.expected[d];
+    }
+    mismatches += failed;
+    nodes += position.nodes;
+
+    std::printf("%5zu %-4s %10.1f ms %14llu nodes %8.2f Mnps  %s\n", position.line,
+                failed ? "FAIL" : "ok", position.seconds * 1e3,
+                static_cast<unsigned long long>(position.nodes),
+                position.seconds > 0 ? position.nodes / position.seconds / 1e6 : 0.0,
+                position.fen.c_str());
+    for (auto d = 1; d <= depth; ++d) {
+      if (position.found[d] != position.expected[d]) {
+        std::printf("      D%d expected %llu, got %llu\n", d,
+                    static_cast<unsigned long long>(position.expected[d]),
+                    static_cast<unsigned long long>(position.found[d]));
+      }
+    }
+  }
+
+  std::printf("%zu positions, %zu mismatched, %llu nodes in %.2f s, %.2f Mnps on %zu threads\n",
+              positions.size(), mismatches, static_cast<unsigned long long>(nodes), seconds,
+              seconds > 0 ? nodes / seconds / 1e6 : 0.0, workers.size());
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,514 @@
+//
+// Copyright (C) 2019-2019 markhc
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+//
+// Perft split across processes through a work queue on disk, for runs too deep for one process
+// or one machine to finish in one go.
+//
+//   chessgen_perft split  <dir> <depth> <split depth> [fen]
+//   chessgen_perft work   <dir> [--bulk] [--hash MB] [--stale SECONDS]
+//   chessgen_perft status <dir>
+//   chessgen_perft merge  <dir>
+//
+// split walks the tree down to the split depth and writes one work unit per distinct position
+// found there, with the number of paths that lead to it. Any number of workers, on this machine
+// or on others sharing the directory, then take units until none are left. merge adds up the
+// results in unit order once every unit is done.
+//
+// The queue is a directory per state, and every change is a rename, which is atomic:
+//
+//   job            the root position, depths and number of units
+//   pending/<id>   units nobody works on
+//   claimed/<id>.<worker>
+//                  a unit being worked on. Its worker renamed it from pending/, which only one
+//                  worker can do. After each move of the unit's position it rewrites the file
+//                  with the node count of that move, so a unit that is picked up again resumes
+//                  where it stopped
+//   done/<id>      the unit's node count
+//   tmp/           files being written, renamed into place once complete
+//
+// Workers touch their claims every few seconds. A claim left untouched for longer than --stale
+// seconds belongs to a worker that died, and goes back to pending/ with its checkpoints. Stopping
+// every worker and starting new ones later resumes the run the same way. Workers log to stderr.
+//
+
+#include <chessgen/board.hpp>
+#include <chessgen/perft.hpp>
+#include <chessgen/ucimove.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+using namespace chessgen;
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr char const* _initialFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// A unit, as stored in pending/ and claimed/
+struct WorkUnit {
+  std::string                          fen;
+  int                                  depth{0};  // Left to search from fen
+  std::uint64_t                        count{0};  // Paths from the root that reach fen
+  std::map<std::string, std::uint64_t> finished;  // Nodes below each move already searched
+};
+
+struct Job {
+  std::string fen;
+  int         depth{0};
+  int         split{0};
+  std::size_t units{0};
+};
+
+// -------------------------------------------------------------------------------------------------
+// Key and value pairs, one per line, the value being the rest of the line
+std::vector<std::pair<std::string, std::string>> readFields(fs::path const& path)
+{
+  auto fields = std::vector<std::pair<std::string, std::string>>{};
+  auto file   = std::ifstream{path};
+  for (auto line = std::string{}; std::getline(file, line);) {
+    auto const space = line.find(' ');
+    if (space == std::string::npos) continue;
+    fields.emplace_back(line.substr(0, space), line.substr(space + 1));
+  }
+  return fields;
+}
+// -------------------------------------------------------------------------------------------------
+// Writes the file next to the queue and renames it into place, so readers never see half of it
+bool writeAtomically(fs::path const& dir, fs::path const& path, std::string const& text)
+{
+  static std::atomic<unsigned> counter{0};
+  auto const temp = dir / "tmp" / (path.filename().string() + "." + std::to_string(counter++));
+  {
+    auto file = std::ofstream{temp, std::ios::binary | std::ios::trunc};
+    file << text;
+    if (!file.flush()) return false;
+  }
+
+  auto error = std::error_code{};
+  fs::rename(temp, path, error);
+  if (error) fs::remove(temp, error);
+  return !error;
+}
+// -------------------------------------------------------------------------------------------------
+bool readJob(fs::path const& dir, Job& job)
+{
+  for (auto const& [key, value] : readFields(dir / "job")) {
+    if (key == "fen") job.fen = value;
+    if (key == "depth") job.depth = std::atoi(value.c_str());
+    if (key == "split") job.split = std::atoi(value.c_str());
+    if (key == "units") job.units = std::strtoull(value.c_str(), nullptr, 10);
+  }
+  if (job.fen.empty() || job.units == 0) {
+    std::fprintf(stderr, "%s is not a perft queue\n", dir.string().c_str());
+    return false;
+  }
+  return true;
+}
+// -------------------------------------------------------------------------------------------------
+WorkUnit readUnit(fs::path const& path)
+{
+  auto unit = WorkUnit{};
+  for (auto const& [key, value] : readFields(path)) {
+    if (key == "fen") unit.fen = value;
+    if (key == "depth") unit.depth = std::atoi(value.c_str());
+    if (key == "count") unit.count = std::strtoull(value.c_str(), nullptr, 10);
+    if (key == "move") {
+      auto const space = value.find(' ');
+      unit.finished[value.substr(0, space)] =
+          std::strtoull(value.c_str() + std::min(space, value.size()), nullptr, 10);
+    }
+  }
+  return unit;
+}
+// -------------------------------------------------------------------------------------------------
+std::string formatUnit(WorkUnit const& unit)
+{
+  auto text = std::ostringstream{};
+  text << "fen " << unit.fen << "\ndepth " << unit.depth << "\ncount " << unit.count << "\n";
+  for (auto const& [move, nodes] : unit.finished) {
+    text << "move " << move << " " << nodes << "\n";
+  }
+  return text.str();
+}
+// -------------------------------------------------------------------------------------------------
+std::string unitName(std::size_t id)
+{
+  char name[24];
+  std::snprintf(name, sizeof(name), "%08zu", id);
+  return name;
+}
+// -------------------------------------------------------------------------------------------------
+// The unit id a claim file is named after, the part before the worker name
+std::string claimedUnit(fs::path const& claim)
+{
+  auto const name = claim.filename().string();
+  return name.substr(0, name.find('.'));
+}
+// -------------------------------------------------------------------------------------------------
+std::string makeWorkerName()
+{
+  auto host = std::string{"worker"};
+  auto pid  = std::to_string(std::random_device{}());
+#if defined(__unix__) || defined(__APPLE__)
+  char buffer[256] = {};
+  if (gethostname(buffer, sizeof(buffer) - 1) == 0 && buffer[0]) host = buffer;
+  pid = std::to_string(getpid());
+#endif
+  return host + "-" + pid;
+}
+// -------------------------------------------------------------------------------------------------
+// Paths from the current position down to each distinct position depth plies below, in the order
+// they are first found
+void collectUnits(SingleThreadBoard&                            board,
+                  int                                           depth,
+                  std::vector<WorkUnit>&                        units,
+                  std::unordered_map<std::string, std::size_t>& index)
+{
+  if (depth == 0) {
+    auto const fen      = board.getFen();
+    auto const inserted = index.emplace(fen, units.size());
+    if (inserted.second) units.push_back(WorkUnit{fen, 0, 0, {}});
+    ++units[inserted.first->second].count;
+    return;
+  }
+
+  auto const moves = MoveList{board.getLegalMoves()};
+  for (auto const& move : moves) {
+    board.makeMove(move);
+    collectUnits(board, depth - 1, units, index);
+    board.undoMove();
+  }
+}
+// -------------------------------------------------------------------------------------------------
+int split(fs::path const& dir, int depth, int splitDepth, std::string const& fen)
+{
+  if (depth < 0 || splitDepth < 0 || splitDepth > depth) {
+    std::fprintf(stderr, "the split depth must be between 0 and the depth\n");
+    return 2;
+  }
+  if (fs::exists(dir / "job")) {
+    std::fprintf(stderr, "%s already holds a perft queue\n", dir.string().c_str());
+    return 2;
+  }
+
+  auto board = std::unique_ptr<SingleThreadBoard>{};
+  try {
+    board = std::make_unique<SingleThreadBoard>(fen);
+  } catch (std::exception const& e) {
+    std::fprintf(stderr, "invalid FEN: %s\n", e.what());
+    return 2;
+  }
+
+  auto units = std::vector<WorkUnit>{};
+  auto index = std::unordered_map<std::string, std::size_t>{};
+  collectUnits(*board, splitDepth, units, index);
+
+  for (auto sub : {"pending", "claimed", "done", "tmp"}) {
+    fs::create_directories(dir / sub);
+  }
+  for (auto id = std::size_t{0}; id < units.size(); ++id) {
+    units[id].depth = depth - splitDepth;
+    if (!writeAtomically(dir, dir / "pending" / unitName(id), formatUnit(units[id]))) {
+      std::fprintf(stderr, "cannot write to %s\n", dir.string().c_str());
+      return 2;
+    }
+  }
+
+  // The job file goes last, a queue without one is not complete
+  auto job = std::ostringstream{};
+  job << "fen " << board->getFen() << "\ndepth " << depth << "\nsplit " << splitDepth
+      << "\nunits " << units.size() << "\n";
+  if (!writeAtomically(dir, dir / "job", job.str())) return 2;
+
+  std::printf("%zu units at depth %d, %d plies each\n", units.size(), splitDepth,
+              depth - splitDepth);
+  return 0;
+}
+// -------------------------------------------------------------------------------------------------
+// Sends claims nobody touched for too long back to pending/, checkpoints included. Returns how
+// many claims are still held
+std::size_t requeueStale(fs::path const& dir, std::chrono::seconds stale)
+{
+  auto       held  = std::size_t{0};
+  auto const now   = fs::file_time_type::clock::now();
+  auto       error = std::error_code{};
+  for (auto const& entry : fs::directory_iterator{dir / "claimed", error}) {
+    auto const touched = fs::last_write_time(entry.path(), error);
+    if (error) continue;
+
+    if (now - touched > stale) {
+      fs::rename(entry.path(), dir / "pending" / claimedUnit(entry.path()), error);
+      if (!error) {
+        std::fprintf(stderr, "requeued %s\n", entry.path().filename().string().c_str());
+        continue;
+      }
+    }
+    ++held;
+  }
+  return held;
+}
+// -------------------------------------------------------------------------------------------------
+// Takes the first pending unit no other worker took first
+bool claimUnit(fs::path const& dir, std::string const& worker, fs::path& claim)
+{
+  auto names = std::vector<std::string>{};
+  auto error = std::error_code{};
+  for (auto const& entry : fs::directory_iterator{dir / "pending", error}) {
+    names.push_back(entry.path().filename().string());
+  }
+  std::sort(names.begin(), names.end());
+
+  for (auto const& name : names) {
+    claim = dir / "claimed" / (name + "." + worker);
+    fs::rename(dir / "pending" / name, claim, error);
+    if (!error) return true;
+  }
+  return false;
+}
+// -------------------------------------------------------------------------------------------------
+// Touches a claim until stopped, so other workers can tell it from the claim of a dead worker
+class Heartbeat
+{
+public:
+  Heartbeat(fs::path claim, std::chrono::seconds interval)
+      : mClaim(std::move(claim)), mThread([this, interval] { run(interval); })
+  {
+  }
+  ~Heartbeat()
+  {
+    {
+      auto const lock = std::lock_guard<std::mutex>{mMutex};
+      mStop           = true;
+    }
+    mWake.notify_one();
+    mThread.join();
+  }
+  Heartbeat(Heartbeat const&) = delete;
+  Heartbeat& operator=(Heartbeat const&) = delete;
+
+private:
+  void run(std::chrono::seconds interval)
+  {
+    auto lock = std::unique_lock<std::mutex>{mMutex};
+    while (!mWake.wait_for(lock, interval, [this] { return mStop; })) {
+      auto error = std::error_code{};
+      fs::last_write_time(mClaim, fs::file_time_type::clock::now(), error);
+    }
+  }
+
+  fs::path                mClaim;
+  std::mutex              mMutex;
+  std::condition_variable mWake;
+  bool                    mStop{false};
+  std::thread             mThread;
+};
+// -------------------------------------------------------------------------------------------------
+bool runUnit(fs::path const&      dir,
+             fs::path const&      claim,
+             PerftOptions const&  options,
+             std::chrono::seconds stale)
+{
+  auto const id   = claimedUnit(claim);
+  auto       unit = readUnit(claim);
+  auto       done = dir / "done" / id;
+
+  auto error = std::error_code{};
+  if (!fs::exists(done)) {
+    auto const heartbeat = Heartbeat{claim, std::max(std::chrono::seconds{1}, stale / 4)};
+    auto const begin     = std::chrono::steady_clock::now();
+
+    auto board = SingleThreadBoard{unit.fen};
+    auto nodes = unit.depth == 0 ? std::uint64_t{1} : std::uint64_t{0};
+    if (unit.depth > 0) {
+      auto const moves = MoveList{board.getLegalMoves()};
+      auto const color = board.getActivePlayer();
+      for (auto const& move : moves) {
+        auto const uci = toUciString(move, color);
+        auto const it  = unit.finished.find(uci);
+        if (it == unit.finished.end()) {
+          board.makeMove(move);
+          unit.finished[uci] = perft(board.getState(), unit.depth - 1, options);
+          board.undoMove();
+
+          // Checkpoint. The claim may have been requeued in the meantime, then only the
+          // result below counts
+          writeAtomically(dir, claim, formatUnit(unit));
+        }
+        nodes += unit.finished[uci];
+      }
+    }
+
+    auto const seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    auto text = std::ostringstream{};
+    text << "count " << unit.count << "\nnodes " << nodes << "\n";
+    if (!writeAtomically(dir, done, text.str())) {
+      std::fprintf(stderr, "cannot write %s\n", done.string().c_str());
+      return false;
+    }
+    std::fprintf(stderr, "unit %s: %llu nodes in %.2f s\n", id.c_str(),
+                 static_cast<unsigned long long>(nodes), seconds);
+  }
+
+  fs::remove(claim, error);
+  return true;
+}
+// -------------------------------------------------------------------------------------------------
+int work(fs::path const& dir, PerftOptions const& options, std::chrono::seconds stale)
+{
+  auto job = Job{};
+  if (!readJob(dir, job)) return 2;
+
+  auto const worker = makeWorkerName();
+  auto       units  = 0;
+  while (true) {
+    auto const held  = requeueStale(dir, stale);
+    auto       claim = fs::path{};
+    if (claimUnit(dir, worker, claim)) {
+      if (!runUnit(dir, claim, options, stale)) return 2;
+      ++units;
+      continue;
+    }
+
+    // Nothing left to take. Wait on the other workers' claims, one may yet come back
+    if (held == 0) break;
+    std::this_thread::sleep_for(std::chrono::seconds{1});
+  }
+
+  std::fprintf(stderr, "%s: %d units\n", worker.c_str(), units);
+  return 0;
+}
+// -------------------------------------------------------------------------------------------------
+int status(fs::path const& dir, bool merge)
+{
+  auto job = Job{};
+  if (!readJob(dir, job)) return 2;
+
+  // Units are added in id order so the total never depends on who finished first
+  auto total    = std::uint64_t{0};
+  auto finished = std::size_t{0};
+  for (auto id = std::size_t{0}; id < job.units; ++id) {
+    auto const path = dir / "done" / unitName(id);
+    if (!fs::exists(path)) continue;
+
+    auto count = std::uint64_t{0};
+    auto nodes = std::uint64_t{0};
+    for (auto const& [key, value] : readFields(path)) {
+      if (key == "count") count = std::strtoull(value.c_str(), nullptr, 10);
+      if (key == "nodes") nodes = std::strtoull(value.c_str(), nullptr, 10);
+    }
+    total += count * nodes;
+    ++finished;
+  }
+
+  // Checkpoints of the units still out
+  auto partial = std::uint64_t{0};
+  auto error   = std::error_code{};
+  auto claimed = std::size_t{0};
+  for (auto sub : {"pending", "claimed"}) {
+    for (auto const& entry : fs::directory_iterator{dir / sub, error}) {
+      auto const unit = readUnit(entry.path());
+      for (auto const& move : unit.finished) {
+        partial += unit.count * move.second;
+      }
+      claimed += sub == std::string_view{"claimed"};
+    }
+  }
+
+  std::printf("%s depth %d: %zu of %zu units done, %zu claimed, %llu nodes", job.fen.c_str(),
+              job.depth, finished, job.units, claimed, static_cast<unsigned long long>(total));
+  std::printf(" (%llu more checkpointed)\n", static_cast<unsigned long long>(partial));
+  if (!merge) return 0;
+  if (finished < job.units) return 1;
+
+  std::printf("perft(%d) = %llu\n", job.depth, static_cast<unsigned long long>(total));
+  auto text = std::ostringstream{};
+  text << "nodes " << total << "\n";
+  return writeAtomically(dir, dir / "result", text.str()) ? 0 : 2;
+}
+// -------------------------------------------------------------------------------------------------
+int usage()
+{
+  std::fprintf(stderr,
+               "usage: chessgen_perft split  <dir> <depth> <split depth> [fen]\n"
+               "       chessgen_perft work   <dir> [--bulk] [--hash MB] [--stale SECONDS]\n"
+               "       chessgen_perft status <dir>\n"
+               "       chessgen_perft merge  <dir>\n");
+  return 2;
+}
+}  // namespace
+
+// -------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  if (argc < 3) return usage();
+
+  auto const command = std::string_view{argv[1]};
+  auto const dir     = fs::path{argv[2]};
+  if (command == "split" && (argc == 5 || argc == 6)) {
+    return split(dir, std::atoi(argv[3]), std::atoi(argv[4]), argc == 6 ? argv[5] : _initialFen);
+  }
+  if (command == "status" && argc == 3) return status(dir, false);
+  if (command == "merge" && argc == 3) return status(dir, true);
+  if (command != "work") return usage();
+
+  auto bulk  = false;
+  auto hash  = 0;  // Megabytes
+  auto stale = std::chrono::seconds{60};
+  for (auto i = 3; i < argc; ++i) {
+    auto const arg = std::string_view{argv[i]};
+    if (arg == "--bulk") {
+      bulk = true;
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hash = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--stale" && i + 1 < argc) {
+      stale = std::chrono::seconds{std::max(1, std::atoi(argv[++i]))};
+    } else {
+      return usage();
+    }
+  }
+
+  auto table = std::unique_ptr<PerftTable>{};
+  if (hash > 0) table = std::make_unique<PerftTable>(static_cast<std::size_t>(hash));
+  return work(dir, PerftOptions{bulk, table.get()}, stale);
+}
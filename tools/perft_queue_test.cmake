@@ -0,0 +1,27 @@
+# Runs a small perft through the work queue, with two workers at once, and checks the total.
+#
+#   cmake -DPERFT=<path to chessgen_perft> -DDIR=<scratch directory> -P perft_queue_test.cmake
+
+file(REMOVE_RECURSE ${DIR})
+
+execute_process(COMMAND ${PERFT} split ${DIR} 4 2 RESULT_VARIABLE result OUTPUT_QUIET)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "split failed: ${result}")
+endif()
+
+# Both commands of a pipeline run at the same time
+execute_process(
+  COMMAND ${PERFT} work ${DIR}
+  COMMAND ${PERFT} work ${DIR} --bulk --hash 1
+  RESULTS_VARIABLE results
+  ERROR_QUIET)
+if(NOT results STREQUAL "0;0")
+  message(FATAL_ERROR "workers failed: ${results}")
+endif()
+
+execute_process(COMMAND ${PERFT} merge ${DIR} RESULT_VARIABLE result OUTPUT_VARIABLE output)
+if(NOT result EQUAL 0 OR NOT output MATCHES "perft\\(4\\) = 197281\n")
+  message(FATAL_ERROR "merge failed: ${result}\n${output}")
+endif()
+
+file(REMOVE_RECURSE ${DIR})